@@ -0,0 +1,66 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the heap allocation counter used by the self-test and the benchmark
+*
+*/
+
+#include "AllocationCounter.h"
+
+#ifdef SHA256_COUNT_ALLOCATIONS
+
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+// The count of heap allocations made by the current thread
+thread_local unsigned long long allocationsCount = 0;
+
+// Counts every heap allocation of the program before passing it to the C allocator
+void* operator new(size_t size)
+{
+	allocationsCount++;
+
+	void* memory = malloc(size == 0 ? 1 : size);
+	if (memory == nullptr)
+	{
+		throw bad_alloc();
+	}
+
+	return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	free(memory);
+}
+
+// Returns the count of heap allocations made by the current thread so far
+unsigned long long getAllocationsCount()
+{
+	return allocationsCount;
+}
+
+#else
+
+// The allocations aren't counted, so there are never any
+unsigned long long getAllocationsCount()
+{
+	return 0;
+}
+
+#endif
\ No newline at end of file
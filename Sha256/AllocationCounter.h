@@ -0,0 +1,26 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the declaration of the heap allocation counter used by the self-test and the benchmark
+* Defining SHA256_COUNT_ALLOCATIONS replaces the global operator new with one that counts the allocations of each thread,
+* without it the program keeps the standard allocator and nothing is counted
+*
+*/
+
+#pragma once
+
+#ifdef SHA256_COUNT_ALLOCATIONS
+const bool ARE_ALLOCATIONS_COUNTED = true;
+#else
+const bool ARE_ALLOCATIONS_COUNTED = false;
+#endif
+
+unsigned long long getAllocationsCount();
\ No newline at end of file
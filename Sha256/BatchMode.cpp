@@ -0,0 +1,892 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the non-interactive command line mode
+* It hashes many files on a pool of worker threads and prints the results in the format of sha256sum
+*
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#include "BatchMode.h"
+#include "Dedup.h"
+#include "DigestCache.h"
+#include "FileHashing.h"
+#include "Manifest.h"
+#include "Metrics.h"
+#include "Sha2.h"
+#include "Sha256Constexpr.h"
+#include "TreeHashing.h"
+
+using namespace std;
+
+const unsigned long long WHOLE_FILE = (unsigned long long)-1;
+const size_t SLOWEST_FILES_COUNT = 5;
+
+// The settings given on the command line
+struct BatchOptions
+{
+	bool isRecursive;
+	bool isTreeHash;
+	bool isListingDuplicates;
+	bool isVerifying;
+	bool isDirect;
+	bool isChecking;
+	string dedupIndexPath;
+	string cachePath;
+	string metricsPath;
+	Sha2Algorithm algorithm;
+	unsigned int workersCount;
+	vector<string> paths;
+};
+
+// How the workers read the files - through the digest cache if there is one
+// SHA256 digests go through the digest cache, the other SHA-2 variants are always hashed with the feed function
+struct BatchHasher
+{
+	DigestCache* cache;
+	bool isVerifying;
+	FileDigestFunction hashFunction;
+	Sha2Algorithm algorithm;
+	FileFeedFunction feedFunction;
+};
+
+// The files to hash and their results, shared between the workers and the printing thread
+struct BatchResults
+{
+	vector<string> files;
+	vector<char*> hashes;
+	vector<bool> isDone;
+	vector<bool> isCacheMismatch;
+	BatchHasher hasher;
+	atomic<size_t> nextFile;
+	mutex doneMutex;
+	condition_variable doneCondition;
+};
+
+// The result of checking one manifest entry
+struct CheckedFile
+{
+	CachedHashSource source;
+	bool isMatching;
+	unsigned long long size;
+	double seconds;
+};
+
+// The manifest entries to check and their results, shared between the workers and the printing thread
+struct CheckResults
+{
+	const Manifest* manifest;
+	vector<CheckedFile> files;
+	vector<bool> isDone;
+	BatchHasher hasher;
+	atomic<size_t> nextEntry;
+	mutex doneMutex;
+	condition_variable doneCondition;
+};
+
+// Prints the command line usage
+void printUsage()
+{
+	cout << "Usage: Sha256 [-r] [-t] [-a algorithm] [-j workers] [-d index [-l]] [--cache log [--verify]] [--direct] [--metrics file] [--] path..." << endl;
+	cout << "Usage: Sha256 -c [-j workers] [--cache log [--verify]] [--direct] [--metrics file] [--] manifest..." << endl;
+	cout << "Prints the SHA256 hash of each file as \"hash  path\", in the order the files are given" << endl;
+	cout << "A path named - is the standard input" << endl;
+	cout << "  -r          hash the files of the given directories and their subdirectories" << endl;
+	cout << "  -t          tree hash mode - hashes the 1 MiB chunks of each file in parallel and prints" << endl;
+	cout << "              the Merkle tree root as \"SHA256-TREE-1M (path) = root\"" << endl;
+	cout << "              The root is NOT the SHA256 hash of the file" << endl;
+	cout << "  -a algorithm hash with another SHA-2 variant - sha224, sha256, sha384, sha512 or sha512/256" << endl;
+	cout << "              SHA-512/256 is faster than SHA256 on 64 bit processors without the SHA extensions" << endl;
+	cout << "              Only SHA256 can be used with -c, -t, -d and --cache" << endl;
+	cout << "  -j workers  hash with the given amount of threads (default - one per processor core)" << endl;
+	cout << "  -d index    deduplication mode - splits the files into content-defined chunks, adds their hashes to" << endl;
+	cout << "              the given index file and prints how much of each file was already in the index" << endl;
+	cout << "  -l          with -d, also prints where every duplicate chunk was first seen" << endl;
+	cout << "  --cache log answers unchanged files from a digest cache kept in the given file, without reading them" << endl;
+	cout << "              A file is unchanged if its device, inode, size and modification time are the same" << endl;
+	cout << "  --verify    with --cache, reads every file anyway and reports files that no longer match the cache" << endl;
+	cout << "  --direct    reads the files with direct I/O that bypasses the system cache, where it is supported" << endl;
+	cout << "  --metrics file writes the counters, the time of each hashing stage and a histogram of the file latencies" << endl;
+	cout << "              to the given file at the end - as JSON if its name ends with .json, else in the Prometheus format" << endl;
+	cout << "  -c          check mode - reads \"hash  path\" lines from the given manifests, checks the listed files" << endl;
+	cout << "              in parallel, prints OK or FAILED for each of them and the throughput and latency statistics" << endl;
+	cout << "              A manifest named - is read from the standard input" << endl;
+	cout << "Usage: Sha256 --benchmark [max message bytes]" << endl;
+	cout << "Measures each hashing stage and messages of up to the given size (default - 64 MiB)" << endl;
+	cout << "Usage: Sha256 --self-test" << endl;
+	cout << "Checks the known answers and, in builds with SHA256_COUNT_ALLOCATIONS, that the allocation-free functions don't allocate" << endl;
+	cout << "Usage: Sha256 --search-nonce header target [nonces] [workers]" << endl;
+	cout << "Searches for the lowest nonce from the one in the 80 byte header whose double SHA256 is within the target" << endl;
+	cout << "Usage: Sha256 --cavp file..." << endl;
+	cout << "Checks every kernel the processor supports against NIST CAVP ShortMsg, LongMsg and Monte Carlo response files" << endl;
+	cout << "Usage: Sha256 --daemon socket [workers]" << endl;
+	cout << "Hashes the requests of local clients on a Unix domain socket until it is stopped, see Daemon.h" << endl;
+	cout << "Without arguments the program starts in interactive mode" << endl;
+}
+
+// Parses the command line arguments
+// Returns false if they are invalid
+bool parseOptions(int argc, char** argv, BatchOptions& options)
+{
+	options.isRecursive = false;
+	options.isTreeHash = false;
+	options.isListingDuplicates = false;
+	options.isVerifying = false;
+	options.isDirect = false;
+	options.isChecking = false;
+	options.algorithm = SHA2_256;
+	options.workersCount = thread::hardware_concurrency();
+
+	bool areOptionsEnded = false;
+	for (int i = 1; i < argc; i++)
+	{
+		string argument = argv[i];
+
+		if (areOptionsEnded || argument == "-" || argument.empty() || argument[0] != '-')
+		{
+			options.paths.push_back(argument);
+		}
+		else if (argument == "--")
+		{
+			areOptionsEnded = true;
+		}
+		else if (argument == "-r")
+		{
+			options.isRecursive = true;
+		}
+		else if (argument == "-t")
+		{
+			options.isTreeHash = true;
+		}
+		else if (argument == "-c")
+		{
+			options.isChecking = true;
+		}
+		else if (argument == "-d" && i + 1 < argc)
+		{
+			options.dedupIndexPath = argv[++i];
+		}
+		else if (argument == "--cache" && i + 1 < argc)
+		{
+			options.cachePath = argv[++i];
+		}
+		else if (argument == "--verify")
+		{
+			options.isVerifying = true;
+		}
+		else if (argument == "--direct")
+		{
+			options.isDirect = true;
+		}
+		else if (argument == "--metrics" && i + 1 < argc)
+		{
+			options.metricsPath = argv[++i];
+			enableMetrics();
+		}
+		else if (argument == "-l")
+		{
+			options.isListingDuplicates = true;
+		}
+		else if ((argument == "-a" || argument == "--algorithm") && i + 1 < argc)
+		{
+			if (!parseSha2Algorithm(argv[++i], options.algorithm))
+			{
+				cerr << argv[i] << ": unknown algorithm, use sha224, sha256, sha384, sha512 or sha512/256" << endl;
+				return false;
+			}
+		}
+		else if (argument == "-j" && i + 1 < argc)
+		{
+			options.workersCount = (unsigned int)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (argument == "-h" || argument == "--help")
+		{
+			return false;
+		}
+		else
+		{
+			cerr << argument << ": unknown option or missing value, use -- before paths that start with -" << endl;
+			return false;
+		}
+	}
+
+	if (options.workersCount == 0)
+	{
+		options.workersCount = 1;
+	}
+
+	bool isOnlyHashing = !options.isChecking && !options.isTreeHash && options.dedupIndexPath.empty() && options.cachePath.empty();
+	if (options.algorithm != SHA2_256 && !isOnlyHashing)
+	{
+		cerr << "-a: only SHA256 can be used with -c, -t, -d and --cache" << endl;
+		return false;
+	}
+
+	return !options.paths.empty();
+}
+
+// Starts a result line about a path - with a backslash if the path is escaped like sha256sum does
+void printLineStart(const string& path)
+{
+	if (isPathEscaped(path.c_str()))
+	{
+		cout << '\\';
+	}
+}
+
+// Prints a path of a result line, escaped if it has a backslash or a line end so the line can be checked with -c
+void printLinePath(const string& path)
+{
+	if (isPathEscaped(path.c_str()))
+	{
+		cout << escapePath(path.c_str());
+	}
+	else
+	{
+		cout << path;
+	}
+}
+
+// Joins a directory path and the name of one of its entries
+string joinPath(const string& directory, const string& name)
+{
+	if (!directory.empty() && (directory.back() == '/' || directory.back() == '\\'))
+	{
+		return directory + name;
+	}
+
+	return directory + "/" + name;
+}
+
+#ifdef _WIN32
+
+// Checks whether the given path is a directory
+bool isDirectory(const string& path)
+{
+	DWORD attributes = GetFileAttributesA(path.c_str());
+
+	return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+}
+
+// Lists the names of the entries of a directory, without the current and parent directory entries
+// Returns false if the directory can't be read
+bool listDirectory(const string& path, vector<string>& names, vector<bool>& areDirectories)
+{
+	WIN32_FIND_DATAA entry;
+	HANDLE search = FindFirstFileA(joinPath(path, "*").c_str(), &entry);
+	if (search == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	do
+	{
+		string name = entry.cFileName;
+		if (name == "." || name == "..")
+		{
+			continue;
+		}
+
+		bool isLink = (entry.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0;
+		names.push_back(name);
+		areDirectories.push_back(!isLink && (entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY));
+	} while (FindNextFileA(search, &entry));
+
+	FindClose(search);
+	return true;
+}
+
+#else
+
+// Checks whether the given path is a directory
+bool isDirectory(const string& path)
+{
+	struct stat info;
+
+	return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+// Lists the names of the entries of a directory, without the current and parent directory entries
+// Symbolic links to directories aren't marked as directories, so they can't cause endless recursion
+// Returns false if the directory can't be read
+bool listDirectory(const string& path, vector<string>& names, vector<bool>& areDirectories)
+{
+	DIR* directory = opendir(path.c_str());
+	if (directory == nullptr)
+	{
+		return false;
+	}
+
+	while (dirent* entry = readdir(directory))
+	{
+		string name = entry->d_name;
+		if (name == "." || name == "..")
+		{
+			continue;
+		}
+
+		struct stat info;
+		bool isSubdirectory = lstat(joinPath(path, name).c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+
+		names.push_back(name);
+		areDirectories.push_back(isSubdirectory);
+	}
+
+	closedir(directory);
+	return true;
+}
+
+#endif
+
+// Adds the files of a directory and its subdirectories, sorted by name so the order doesn't depend on the file system
+// Returns false if any directory can't be read
+bool collectDirectoryFiles(const string& path, vector<string>& files)
+{
+	vector<string> names;
+	vector<bool> areDirectories;
+	if (!listDirectory(path, names, areDirectories))
+	{
+		cerr << path << ": the directory couldn't be read" << endl;
+		return false;
+	}
+
+	vector<size_t> order(names.size());
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		order[i] = i;
+	}
+	sort(order.begin(), order.end(), [&names](size_t first, size_t second) { return names[first] < names[second]; });
+
+	bool success = true;
+	for (size_t index : order)
+	{
+		string entryPath = joinPath(path, names[index]);
+		if (areDirectories[index])
+		{
+			success = collectDirectoryFiles(entryPath, files) && success;
+		}
+		else
+		{
+			files.push_back(entryPath);
+		}
+	}
+
+	return success;
+}
+
+// Expands the command line paths into the list of files to hash
+// Returns false if any path can't be used
+bool collectFiles(const BatchOptions& options, vector<string>& files)
+{
+	bool success = true;
+	for (const string& path : options.paths)
+	{
+		if (path == STANDARD_INPUT_PATH || !isDirectory(path))
+		{
+			files.push_back(path);
+		}
+		else if (options.isRecursive)
+		{
+			success = collectDirectoryFiles(path, files) && success;
+		}
+		else
+		{
+			cerr << path << ": is a directory (use -r to hash its files)" << endl;
+			success = false;
+		}
+	}
+
+	return success;
+}
+
+// Hashes a whole file, through the digest cache if there is one
+// The standard input has no identity to cache its digest under, so it is always hashed
+// Returns where the digest comes from or HASH_UNREADABLE if the file can't be read
+CachedHashSource hashBatchDigest(const BatchHasher& hasher, const char* path, Digest& digest)
+{
+	if (hasher.cache == nullptr || strcmp(path, STANDARD_INPUT_PATH) == 0)
+	{
+		return hasher.hashFunction(path, WHOLE_FILE, digest) ? HASH_FROM_FILE : HASH_UNREADABLE;
+	}
+
+	return hashFileCached(*hasher.cache, path, hasher.isVerifying, hasher.hashFunction, digest);
+}
+
+// Hashes a whole file of the batch
+// Returns a string of the hash result or a null pointer if the file can't be read
+char* hashBatchFile(BatchResults& results, const string& file, bool& isCacheMismatch)
+{
+	isCacheMismatch = false;
+	if (results.hasher.algorithm != SHA2_256)
+	{
+		unsigned char result[SHA2_MAX_RESULT_BYTES];
+		if (!hashSha2File(results.hasher.algorithm, results.hasher.feedFunction, file.c_str(), WHOLE_FILE, result))
+		{
+			return nullptr;
+		}
+
+		size_t resultBytes = getSha2ResultBytes(results.hasher.algorithm);
+		char* text = new char[2 * resultBytes + 1];
+		formatHex(result, resultBytes, text);
+		return text;
+	}
+
+	Digest digest;
+	CachedHashSource source = hashBatchDigest(results.hasher, file.c_str(), digest);
+
+	isCacheMismatch = source == HASH_CACHE_MISMATCH;
+	return source == HASH_UNREADABLE ? nullptr : getDigestText(digest);
+}
+
+// Takes the next file that isn't hashed yet until there are none left
+void hashFilesWorker(BatchResults& results)
+{
+	size_t index = results.nextFile++;
+	while (index < results.files.size())
+	{
+		bool isCacheMismatch = false;
+		char* hash = hashBatchFile(results, results.files[index], isCacheMismatch);
+		{
+			lock_guard<mutex> lock(results.doneMutex);
+			results.hashes[index] = hash;
+			results.isCacheMismatch[index] = isCacheMismatch;
+			results.isDone[index] = true;
+		}
+		results.doneCondition.notify_all();
+
+		index = results.nextFile++;
+	}
+}
+
+// Prints each result as soon as it and all results before it are done
+// Returns false if any file couldn't be read
+bool printResultsInOrder(BatchResults& results)
+{
+	bool success = true;
+	for (size_t i = 0; i < results.files.size(); i++)
+	{
+		char* hash = nullptr;
+		bool isCacheMismatch = false;
+		{
+			unique_lock<mutex> lock(results.doneMutex);
+			results.doneCondition.wait(lock, [&results, i]() { return results.isDone[i]; });
+			hash = results.hashes[i];
+			isCacheMismatch = results.isCacheMismatch[i];
+			results.hashes[i] = nullptr;
+		}
+
+		if (isCacheMismatch)
+		{
+			cerr << results.files[i] << ": the file doesn't match its cached hash although it looks unchanged" << endl;
+			success = false;
+		}
+
+		if (hash == nullptr)
+		{
+			cerr << results.files[i] << ": the file couldn't be read" << endl;
+			success = false;
+			continue;
+		}
+
+		printLineStart(results.files[i]);
+		cout << hash << "  ";
+		printLinePath(results.files[i]);
+		cout << '\n';
+		delete[] hash;
+	}
+
+	cout.flush();
+	return success;
+}
+
+// Takes the next manifest entry that isn't checked yet until there are none left
+// The latency of an entry is measured from the start of its hashing until its result is known
+void checkFilesWorker(CheckResults& results)
+{
+	size_t index = results.nextEntry++;
+	while (index < results.manifest->entries.size())
+	{
+		const ManifestEntry& entry = results.manifest->entries[index];
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+		CheckedFile file;
+		Digest digest;
+		FileIdentity identity;
+		file.source = hashBatchDigest(results.hasher, entry.path, digest);
+		file.isMatching = file.source != HASH_UNREADABLE && areDigestsEqual(digest, entry.digest);
+		file.size = file.source != HASH_UNREADABLE && getFileIdentity(entry.path, identity) ? identity.size : 0;
+		file.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		{
+			lock_guard<mutex> lock(results.doneMutex);
+			results.files[index] = file;
+			results.isDone[index] = true;
+		}
+		results.doneCondition.notify_all();
+
+		index = results.nextEntry++;
+	}
+}
+
+// Prints OK or FAILED for each manifest entry as soon as it and all entries before it are checked
+// Returns false if any file doesn't match or couldn't be read
+bool printCheckResultsInOrder(CheckResults& results)
+{
+	bool success = true;
+	for (size_t i = 0; i < results.files.size(); i++)
+	{
+		CheckedFile file;
+		{
+			unique_lock<mutex> lock(results.doneMutex);
+			results.doneCondition.wait(lock, [&results, i]() { return results.isDone[i]; });
+			file = results.files[i];
+		}
+
+		string path = results.manifest->entries[i].path;
+		if (file.source == HASH_CACHE_MISMATCH)
+		{
+			cerr << path << ": the file doesn't match its cached hash although it looks unchanged" << endl;
+		}
+
+		printLineStart(path);
+		printLinePath(path);
+		if (file.source == HASH_UNREADABLE)
+		{
+			cout << ": FAILED open or read" << '\n';
+		}
+		else
+		{
+			cout << (file.isMatching ? ": OK" : ": FAILED") << '\n';
+		}
+
+		success = success && file.isMatching && file.source != HASH_CACHE_MISMATCH;
+	}
+
+	cout.flush();
+	return success;
+}
+
+// Returns the latency below which the given part of the sorted latencies are, by the nearest rank
+double getPercentile(const vector<double>& sortedSeconds, double part)
+{
+	size_t rank = (size_t)(part * sortedSeconds.size() + 0.999999);
+
+	return sortedSeconds[rank == 0 ? 0 : rank - 1];
+}
+
+// Prints the count of failed files, the throughput, the median and 99th percentile latencies and the slowest files
+void printCheckSummary(const CheckResults& results, double elapsedSeconds)
+{
+	const double MIB = 1 << 20;
+	const double MILLISECONDS_IN_SECOND = 1000;
+
+	size_t entriesCount = results.files.size();
+	size_t failedCount = 0;
+	size_t unreadableCount = 0;
+	unsigned long long bytesCount = 0;
+	vector<double> sortedSeconds;
+	vector<size_t> order;
+
+	for (size_t i = 0; i < entriesCount; i++)
+	{
+		const CheckedFile& file = results.files[i];
+		unreadableCount += file.source == HASH_UNREADABLE;
+		failedCount += file.source != HASH_UNREADABLE && !file.isMatching;
+		bytesCount += file.size;
+		sortedSeconds.push_back(file.seconds);
+		order.push_back(i);
+	}
+
+	if (results.manifest->invalidLinesCount > 0)
+	{
+		cerr << "WARNING: " << results.manifest->invalidLinesCount << " lines are improperly formatted" << endl;
+	}
+	if (unreadableCount > 0)
+	{
+		cerr << "WARNING: " << unreadableCount << " listed files could not be read" << endl;
+	}
+	if (failedCount > 0)
+	{
+		cerr << "WARNING: " << failedCount << " computed checksums did NOT match" << endl;
+	}
+
+	if (entriesCount == 0)
+	{
+		return;
+	}
+
+	sort(sortedSeconds.begin(), sortedSeconds.end());
+	size_t slowestCount = min(SLOWEST_FILES_COUNT, entriesCount);
+	partial_sort(order.begin(), order.begin() + slowestCount, order.end(),
+		[&results](size_t first, size_t second) { return results.files[first].seconds > results.files[second].seconds; });
+
+	cerr << "Checked " << entriesCount << " files, " << bytesCount << " bytes in " << elapsedSeconds << " s ("
+		<< bytesCount / MIB / elapsedSeconds << " MiB/s, " << entriesCount / elapsedSeconds << " files/s)" << endl;
+	cerr << "Per file latency: p50 " << getPercentile(sortedSeconds, 0.5) * MILLISECONDS_IN_SECOND << " ms, p99 "
+		<< getPercentile(sortedSeconds, 0.99) * MILLISECONDS_IN_SECOND << " ms" << endl;
+	cerr << "Slowest files:" << endl;
+	for (size_t i = 0; i < slowestCount; i++)
+	{
+		const CheckedFile& file = results.files[order[i]];
+		cerr << "  " << file.seconds * MILLISECONDS_IN_SECOND << " ms, " << file.size << " bytes  "
+			<< results.manifest->entries[order[i]].path << endl;
+	}
+}
+
+// Checks the files listed in the manifests on a pool of workers and prints the report and the statistics
+// Returns false if any manifest can't be read, has no valid lines or lists a file that doesn't match
+bool checkManifests(const BatchOptions& options, const BatchHasher& hasher)
+{
+	bool success = true;
+	Manifest manifest;
+	initManifest(manifest);
+	for (const string& path : options.paths)
+	{
+		if (!addManifestFile(manifest, path.c_str()))
+		{
+			cerr << path << ": the manifest couldn't be read" << endl;
+			success = false;
+		}
+	}
+
+	if (manifest.entries.empty())
+	{
+		cerr << "No properly formatted checksum lines found" << endl;
+		freeManifest(manifest);
+		return false;
+	}
+
+	CheckResults results;
+	results.manifest = &manifest;
+	results.files.resize(manifest.entries.size());
+	results.isDone.assign(manifest.entries.size(), false);
+	results.hasher = hasher;
+	results.nextEntry = 0;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	size_t workersCount = min((size_t)options.workersCount, manifest.entries.size());
+	vector<thread> workers;
+	for (size_t i = 0; i < workersCount; i++)
+	{
+		workers.emplace_back(checkFilesWorker, ref(results));
+	}
+
+	success = printCheckResultsInOrder(results) && success;
+
+	for (thread& worker : workers)
+	{
+		worker.join();
+	}
+
+	printCheckSummary(results, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+
+	freeManifest(manifest);
+	return success;
+}
+
+// Hashes the files one after another, each with all workers on its chunks, and prints the tree roots
+// Returns false if any file couldn't be read
+bool printTreeHashes(const vector<string>& files, unsigned int workersCount)
+{
+	bool success = true;
+	for (const string& file : files)
+	{
+		char* root = hashFileTree(file.c_str(), TREE_CHUNK_BYTES, workersCount);
+		if (root == nullptr)
+		{
+			cerr << file << ": the file couldn't be read" << endl;
+			success = false;
+			continue;
+		}
+
+		printLineStart(file);
+		cout << "SHA256-TREE-1M (";
+		printLinePath(file);
+		cout << ") = " << root << '\n';
+		delete[] root;
+	}
+
+	cout.flush();
+	return success;
+}
+
+// Returns the part of a total as a percentage
+double getPercent(unsigned long long part, unsigned long long total)
+{
+	return total == 0 ? 0 : 100.0 * part / total;
+}
+
+// Adds the chunks of each file to the deduplication index and prints the duplicate chunks of each file and in total
+// Returns false if the index can't be opened or any file couldn't be read
+bool printDedupReport(const vector<string>& files, const BatchOptions& options)
+{
+	DedupIndex index;
+	if (!openDedupIndex(options.dedupIndexPath.c_str(), index))
+	{
+		cerr << options.dedupIndexPath << ": the index couldn't be opened" << endl;
+		return false;
+	}
+
+	bool success = true;
+	DedupFileStats total = { 0, 0, 0, 0 };
+	vector<DedupDuplicate> duplicates;
+
+	for (const string& file : files)
+	{
+		DedupFileStats stats;
+		duplicates.clear();
+		if (!addFileToDedupIndex(index, file.c_str(), stats, options.isListingDuplicates ? &duplicates : nullptr))
+		{
+			cerr << file << ": the file couldn't be read or the index couldn't be updated" << endl;
+			success = false;
+			continue;
+		}
+
+		printLineStart(file);
+		printLinePath(file);
+		cout << ": " << stats.chunksCount << " chunks, " << stats.bytesCount << " bytes, "
+			<< stats.duplicateChunksCount << " duplicate chunks, " << stats.duplicateBytesCount << " duplicate bytes ("
+			<< getPercent(stats.duplicateBytesCount, stats.bytesCount) << "%)" << '\n';
+
+		for (const DedupDuplicate& duplicate : duplicates)
+		{
+			const string& firstFile = index.filePaths[duplicate.firstChunk.fileId];
+			printLineStart(firstFile);
+			cout << "  chunk at " << duplicate.chunk.offset << " (" << duplicate.chunk.size << " bytes) is a duplicate of ";
+			printLinePath(firstFile);
+			cout << " at " << duplicate.firstChunk.offset << '\n';
+		}
+
+		total.chunksCount += stats.chunksCount;
+		total.bytesCount += stats.bytesCount;
+		total.duplicateChunksCount += stats.duplicateChunksCount;
+		total.duplicateBytesCount += stats.duplicateBytesCount;
+	}
+
+	cout << "Total: " << total.chunksCount << " chunks, " << total.bytesCount << " bytes, "
+		<< total.duplicateBytesCount << " duplicate bytes (" << getPercent(total.duplicateBytesCount, total.bytesCount) << "%), "
+		<< getDedupUniqueChunksCount(index) << " unique chunks in the index" << endl;
+
+	closeDedupIndex(index);
+	return success;
+}
+
+// Hashes the files on a pool of workers and prints the results in the order of the files
+// Returns false if any file couldn't be read or doesn't match its cached hash
+bool printFileHashes(vector<string>& files, const BatchHasher& hasher, unsigned int workersCount)
+{
+	BatchResults results;
+	results.files.swap(files);
+	results.hashes.assign(results.files.size(), nullptr);
+	results.isDone.assign(results.files.size(), false);
+	results.isCacheMismatch.assign(results.files.size(), false);
+	results.hasher = hasher;
+	results.nextFile = 0;
+
+	size_t threadsCount = min((size_t)workersCount, results.files.size());
+	vector<thread> workers;
+	for (size_t i = 0; i < threadsCount; i++)
+	{
+		workers.emplace_back(hashFilesWorker, ref(results));
+	}
+
+	bool success = printResultsInOrder(results);
+
+	for (thread& worker : workers)
+	{
+		worker.join();
+	}
+
+	return success;
+}
+
+// Runs the non-interactive mode with the given command line arguments
+// Returns the process exit code - zero if every file was hashed
+int runBatchMode(int argc, char** argv)
+{
+	BatchOptions options;
+	if (!parseOptions(argc, argv, options))
+	{
+		printUsage();
+		return EXIT_FAILURE;
+	}
+
+	DigestCache cache;
+	if (!options.cachePath.empty() && !openDigestCache(options.cachePath.c_str(), cache))
+	{
+		cerr << options.cachePath << ": the digest cache couldn't be opened" << endl;
+		return EXIT_FAILURE;
+	}
+
+	BatchHasher hasher;
+	hasher.cache = options.cachePath.empty() ? nullptr : &cache;
+	hasher.isVerifying = options.isVerifying;
+	hasher.hashFunction = options.isDirect ? hashFileDirectDigest : hashFileDigest;
+	hasher.algorithm = options.algorithm;
+	hasher.feedFunction = options.isDirect ? feedFileDirect : feedFile;
+
+	bool success = true;
+	if (options.isChecking)
+	{
+		success = checkManifests(options, hasher);
+	}
+	else
+	{
+		vector<string> files;
+		success = collectFiles(options, files);
+
+		if (!options.dedupIndexPath.empty())
+		{
+			success = printDedupReport(files, options) && success;
+		}
+		else if (options.isTreeHash)
+		{
+			success = printTreeHashes(files, options.workersCount) && success;
+		}
+		else
+		{
+			success = printFileHashes(files, hasher, options.workersCount) && success;
+		}
+	}
+
+	if (hasher.cache != nullptr)
+	{
+		closeDigestCache(cache);
+	}
+
+	if (!options.metricsPath.empty() && !writeMetricsFile(options.metricsPath.c_str()))
+	{
+		cerr << options.metricsPath << ": the metrics couldn't be written (they may be compiled out with SHA256_NO_METRICS)" << endl;
+		success = false;
+	}
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
\ No newline at end of file
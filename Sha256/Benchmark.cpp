@@ -0,0 +1,312 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the built-in benchmark of the hashing layers
+* It measures the whole hashing of messages and each of its stages on their own - the block kernels,
+* the padding of the final blocks and the hexadecimal formatting of the result
+*
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "AllocationCounter.h"
+#include "Benchmark.h"
+#include "MerkleLog.h"
+#include "Pbkdf2.h"
+#include "SHA256.h"
+#include "Sha2.h"
+#include "Sha256Kernels.h"
+
+#ifdef SHA256_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+using namespace std;
+
+// Every operation is repeated until it has run for at least this long
+const double MIN_MEASURE_SECONDS = 0.2;
+const size_t KERNEL_BENCHMARK_BYTES = 1 << 20;
+
+// The measured cost of a single call of an operation
+struct BenchmarkResult
+{
+	double nanosecondsPerCall;
+	double cyclesPerCall;
+	double allocationsPerCall;
+};
+
+// Reads the processor time stamp counter, or returns zero where there is none
+unsigned long long readCycleCounter()
+{
+#ifdef SHA256_X86
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+// Repeats an operation until enough time has passed and returns the average cost of one call
+template <typename Operation>
+BenchmarkResult measure(Operation operation)
+{
+	operation();
+
+	unsigned long long calls = 0;
+	unsigned long long callsPerRound = 1;
+	unsigned long long startAllocations = getAllocationsCount();
+	unsigned long long startCycles = readCycleCounter();
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	double elapsedSeconds = 0;
+	while (elapsedSeconds < MIN_MEASURE_SECONDS)
+	{
+		for (unsigned long long i = 0; i < callsPerRound; i++)
+		{
+			operation();
+		}
+
+		calls += callsPerRound;
+		callsPerRound *= 2;
+		elapsedSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	}
+
+	BenchmarkResult result;
+	result.nanosecondsPerCall = elapsedSeconds * 1e9 / calls;
+	result.cyclesPerCall = (double)(readCycleCounter() - startCycles) / calls;
+	result.allocationsPerCall = (double)(getAllocationsCount() - startAllocations) / calls;
+
+	return result;
+}
+
+// Prints the header of the results table
+void printResultsHeader()
+{
+	printf("%-28s %12s %14s %10s %12s %12s\n", "benchmark", "bytes", "ns/call", "MB/s", "cycles/byte", "allocs/call");
+}
+
+// Prints a row of the results table
+// The cycles are time stamp counter cycles, so they follow the nominal frequency and not the boosted one
+// The allocations are only shown in builds that count them
+void printResult(const char* name, unsigned long long bytesPerCall, const BenchmarkResult& result)
+{
+	double megabytesPerSecond = bytesPerCall * 1e3 / result.nanosecondsPerCall;
+	double cyclesPerByte = bytesPerCall == 0 ? 0 : result.cyclesPerCall / bytesPerCall;
+
+	printf("%-28s %12llu %14.1f %10.1f %12.2f ",
+		name,
+		bytesPerCall,
+		result.nanosecondsPerCall,
+		megabytesPerSecond,
+		cyclesPerByte);
+
+	if (ARE_ALLOCATIONS_COUNTED)
+	{
+		printf("%12.2f\n", result.allocationsPerCall);
+	}
+	else
+	{
+		printf("%12s\n", "-");
+	}
+}
+
+// Measures a block kernel over a fixed amount of blocks
+void benchmarkBlocksKernel(const char* name, BlocksKernel kernel, const unsigned char* blocks)
+{
+	unsigned int state[8] = { 0 };
+	BenchmarkResult result = measure([&]() { kernel(blocks, KERNEL_BENCHMARK_BYTES / 64, state); });
+
+	printResult(name, KERNEL_BENCHMARK_BYTES, result);
+}
+
+// Measures a multi-buffer kernel with a different block in each lane
+void benchmarkLanesKernel(const char* name, LanesKernel kernel, size_t lanesCount, const unsigned char* blocks)
+{
+	const unsigned char* laneBlocks[AVX512_LANES_COUNT];
+	for (size_t i = 0; i < lanesCount; i++)
+	{
+		laneBlocks[i] = blocks + i * 64;
+	}
+
+	unsigned int laneStates[8 * AVX512_LANES_COUNT] = { 0 };
+	BenchmarkResult result = measure([&]() { kernel(laneBlocks, laneStates); });
+
+	printResult(name, lanesCount * 64, result);
+}
+
+// Measures every block kernel that the processor supports
+void benchmarkKernels(const unsigned char* blocks)
+{
+	benchmarkBlocksKernel("kernel/reference", hashMessageBlocksReference, blocks);
+	benchmarkBlocksKernel("kernel/fast", hashMessageBlocksFast, blocks);
+	benchmarkBlocksKernel("kernel/selected", hashMessageBlocks, blocks);
+
+	unsigned long long sha512State[SHA2_STATE_WORDS] = { 0 };
+	printResult("kernel/sha512 fast", KERNEL_BENCHMARK_BYTES,
+		measure([&]() { hashSha512Blocks(blocks, KERNEL_BENCHMARK_BYTES / 128, sha512State); }));
+
+	if (isShaNiSupported())
+	{
+		benchmarkBlocksKernel("kernel/sha-ni", hashMessageBlocksShaNi, blocks);
+	}
+
+	if (isAvx2Supported())
+	{
+		benchmarkLanesKernel("kernel/avx2 x8", hashLaneBlocksAvx2, AVX2_LANES_COUNT, blocks);
+	}
+
+	if (isAvx512Supported())
+	{
+		benchmarkLanesKernel("kernel/avx512 x16", hashLaneBlocksAvx512, AVX512_LANES_COUNT, blocks);
+	}
+}
+
+// Measures the stages that don't depend on the message size
+void benchmarkStages(const unsigned char* blocks)
+{
+	unsigned char finalBlocks[FINAL_BLOCKS_MAX_BYTES];
+	printResult("padding/createFinalBlocks", 55, measure([&]() { createFinalBlocks(blocks, 55, 55, finalBlocks); }));
+	printResult("padding/createFinalBlocks", 63, measure([&]() { createFinalBlocks(blocks, 63, 63, finalBlocks); }));
+
+	Digest digest = {};
+	char text[DIGEST_TEXT_SIZE];
+	printResult("format/formatDigest", DIGEST_BYTES, measure([&]() { formatDigest(digest, text); }));
+	printResult("format/getDigestText", DIGEST_BYTES, measure([&]() { delete[] getDigestText(digest); }));
+
+	Digest parsedDigest;
+	printResult("format/parseDigest", DIGEST_BYTES, measure([&]() { parseDigest(text, 2 * DIGEST_BYTES, parsedDigest); }));
+}
+
+// Measures the whole hashing of messages of growing sizes
+void benchmarkMessages(char* message, unsigned long long maxMessageBytes)
+{
+	const unsigned long long MESSAGE_SIZES[] =
+	{
+		0, 64, 1ULL << 10, 64ULL << 10, 1ULL << 20, 64ULL << 20, 1ULL << 30
+	};
+
+	for (unsigned long long size : MESSAGE_SIZES)
+	{
+		if (size > maxMessageBytes)
+		{
+			break;
+		}
+
+		const unsigned char* bytes = (const unsigned char*)message;
+		Digest digest;
+		printResult("hashBytesDigest", size, measure([&]() { hashBytesDigest(bytes, (size_t)size, digest); }));
+
+		printResult("hashBytes", size, measure([&]() { delete[] hashBytes(bytes, size); }));
+
+		message[size] = '\0';
+		printResult("hashMessage", size, measure([&]() { delete[] hashMessage(message); }));
+		message[size] = 'a';
+	}
+}
+
+// Measures the whole hashing of a 1 MiB message with each SHA-2 variant
+void benchmarkSha2Variants(const unsigned char* bytes)
+{
+	const Sha2Algorithm ALGORITHMS[] = { SHA2_224, SHA2_256, SHA2_384, SHA2_512, SHA2_512_256 };
+
+	unsigned char result[SHA2_MAX_RESULT_BYTES];
+	for (Sha2Algorithm algorithm : ALGORITHMS)
+	{
+		string name = string("sha2/") + getSha2AlgorithmName(algorithm);
+		printResult(name.c_str(), KERNEL_BENCHMARK_BYTES,
+			measure([&]() { hashSha2Bytes(algorithm, bytes, KERNEL_BENCHMARK_BYTES, result); }));
+	}
+}
+
+// Measures PBKDF2 for one password and for a batch that fills the widest lanes
+// The bytes of a row are the compressed bytes of its iterations - two blocks per iteration and output block
+void benchmarkPbkdf2()
+{
+	const unsigned int ITERATIONS = 1000;
+	const unsigned long long ITERATION_BYTES = 2 * CONTEXT_BLOCK_BYTES;
+
+	MessageSpan passwords[AVX512_LANES_COUNT];
+	MessageSpan salts[AVX512_LANES_COUNT];
+	for (size_t i = 0; i < AVX512_LANES_COUNT; i++)
+	{
+		passwords[i] = { "password", 8 };
+		salts[i] = { "salt", 4 };
+	}
+
+	unsigned char outputs[AVX512_LANES_COUNT * DIGEST_BYTES];
+	printResult("pbkdf2 1000 iterations", ITERATIONS * ITERATION_BYTES,
+		measure([&]() { pbkdf2("password", 8, "salt", 4, ITERATIONS, outputs, DIGEST_BYTES); }));
+	printResult("pbkdf2Many x16", AVX512_LANES_COUNT * ITERATIONS * ITERATION_BYTES,
+		measure([&]() { pbkdf2Many(passwords, salts, AVX512_LANES_COUNT, ITERATIONS, outputs, DIGEST_BYTES); }));
+}
+
+// Measures appending 64-byte entries to a log that is only kept in memory, one by one and in batches of 64
+// The log grows while it is measured, which doesn't matter as an append only touches the frontier
+void benchmarkMerkleLog(const unsigned char* bytes)
+{
+	const size_t ENTRY_BYTES = 64;
+	const size_t BATCH_ENTRIES = 64;
+
+	MessageSpan entries[BATCH_ENTRIES];
+	for (size_t i = 0; i < BATCH_ENTRIES; i++)
+	{
+		entries[i] = { bytes + i * ENTRY_BYTES, ENTRY_BYTES };
+	}
+
+	MerkleLog log;
+	initMerkleLog(log);
+	printResult("merkle append", ENTRY_BYTES,
+		measure([&]() { appendMerkleEntry(log, bytes, ENTRY_BYTES); }));
+	printResult("merkle append x64", BATCH_ENTRIES * ENTRY_BYTES,
+		measure([&]() { appendMerkleEntries(log, entries, BATCH_ENTRIES); }));
+}
+
+// Runs every benchmark and prints the results as a table
+// Messages are only hashed up to the given size, because a message of that size is kept in memory
+// The allocation-free operations are checked by the self-test, the benchmark only reports their allocations
+int runBenchmark(unsigned long long maxMessageBytes)
+{
+	if (maxMessageBytes > (size_t)-2)
+	{
+		cerr << "The maximal message size can't be kept in memory" << endl;
+		return EXIT_FAILURE;
+	}
+
+	size_t bufferBytes = (size_t)maxMessageBytes + 1;
+	if (bufferBytes < KERNEL_BENCHMARK_BYTES)
+	{
+		bufferBytes = KERNEL_BENCHMARK_BYTES;
+	}
+
+	char* message = new char[bufferBytes];
+	for (size_t i = 0; i < bufferBytes; i++)
+	{
+		message[i] = 'a';
+	}
+
+	printResultsHeader();
+	benchmarkKernels((const unsigned char*)message);
+	benchmarkSha2Variants((const unsigned char*)message);
+	benchmarkPbkdf2();
+	benchmarkMerkleLog((const unsigned char*)message);
+	benchmarkStages((const unsigned char*)message);
+	benchmarkMessages(message, maxMessageBytes);
+
+	delete[] message;
+	return EXIT_SUCCESS;
+}
\ No newline at end of file
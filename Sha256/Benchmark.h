@@ -0,0 +1,18 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the declaration of the built-in benchmark of the hashing layers
+*
+*/
+
+#pragma once
+
+int runBenchmark(unsigned long long maxMessageBytes);
\ No newline at end of file
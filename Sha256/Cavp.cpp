@@ -0,0 +1,461 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the NIST CAVP vector runner
+* A response file lists messages by their length in bits ("Len"), their bytes ("Msg") and their digest ("MD"),
+* or the seed of a Monte Carlo test ("Seed") followed by the digest after every 1000 chained hashes
+* Every vector is hashed with each block kernel, and with each multi-buffer kernel as a batch of different messages
+*
+*/
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Cavp.h"
+#include "SHA256.h"
+#include "Sha256Constexpr.h"
+#include "Sha256Kernels.h"
+
+using namespace std;
+
+typedef unsigned char byte;
+typedef unsigned int word32;
+
+const size_t MONTE_CARLO_ITERATIONS = 1000;
+const size_t MONTE_CARLO_CHAIN_DIGESTS = 3;
+const size_t SHA256_DIGEST_PARAMETER = 32;
+const size_t MAX_REPORTED_FAILURES = 5;
+const byte IDLE_CAVP_BLOCK[CONTEXT_BLOCK_BYTES] = { 0 };
+
+// A message of a response file and its expected digest
+struct CavpMessage
+{
+	vector<byte> bytes;
+	Digest digest;
+};
+
+// A Monte Carlo test - its seed and the expected digest at the end of every round of 1000 iterations
+struct CavpMonteCarlo
+{
+	Digest seed;
+	vector<Digest> checkpoints;
+};
+
+// The vectors of one response file
+// Messages whose length isn't whole bytes are counted as skipped, because the hashing API only takes bytes
+struct CavpVectors
+{
+	vector<CavpMessage> messages;
+	vector<CavpMonteCarlo> monteCarloTests;
+	size_t skippedCount;
+};
+
+// A hashing kernel under test, either a block kernel or a multi-buffer kernel with its lanes
+struct CavpKernel
+{
+	const char* name;
+	BlocksKernel blocksKernel;
+	LanesKernel lanesKernel;
+	size_t lanesCount;
+};
+
+// Removes the spaces and the line end around a text
+string trimCavpText(const string& text)
+{
+	size_t start = text.find_first_not_of(" \t\r");
+	if (start == string::npos)
+	{
+		return string();
+	}
+
+	return text.substr(start, text.find_last_not_of(" \t\r") - start + 1);
+}
+
+// Decodes a hexadecimal value of a response file
+bool parseCavpHex(const string& text, vector<byte>& bytes)
+{
+	if (text.size() % 2 != 0)
+	{
+		return false;
+	}
+
+	bytes.resize(text.size() / 2);
+	return parseHex(text.c_str(), text.size(), bytes.data());
+}
+
+// Reads the vectors of a response file
+// The sections of other digest sizes are ignored, so a file of the whole SHA-2 family can be given
+// Returns false if the file can't be read or has a malformed value
+bool readCavpVectors(const char* path, CavpVectors& vectors)
+{
+	ifstream file(path);
+	if (!file)
+	{
+		return false;
+	}
+
+	vectors.skippedCount = 0;
+	bool isInSection = true;
+	bool hasLength = false;
+	unsigned long long lengthBits = 0;
+	vector<byte> message;
+
+	string line;
+	while (getline(file, line))
+	{
+		line = trimCavpText(line);
+		if (line.empty() || line[0] == '#')
+		{
+			continue;
+		}
+
+		size_t separator = line.find('=');
+		if (line[0] == '[')
+		{
+			isInSection = separator == string::npos || line.compare(1, separator - 1, "L ") != 0 ||
+				strtoul(line.c_str() + separator + 1, nullptr, 10) == SHA256_DIGEST_PARAMETER;
+			continue;
+		}
+
+		if (!isInSection || separator == string::npos)
+		{
+			continue;
+		}
+
+		string name = trimCavpText(line.substr(0, separator));
+		string value = trimCavpText(line.substr(separator + 1));
+		if (name == "Len")
+		{
+			lengthBits = strtoull(value.c_str(), nullptr, 10);
+			hasLength = true;
+		}
+		else if (name == "Msg")
+		{
+			if (!parseCavpHex(value, message))
+			{
+				return false;
+			}
+		}
+		else if (name == "Seed" || name == "MD")
+		{
+			vector<byte> digestBytes;
+			if (!parseCavpHex(value, digestBytes) || digestBytes.size() != DIGEST_BYTES)
+			{
+				return false;
+			}
+
+			Digest digest;
+			memcpy(digest.bytes, digestBytes.data(), DIGEST_BYTES);
+
+			if (name == "Seed")
+			{
+				vectors.monteCarloTests.push_back({ digest, vector<Digest>() });
+			}
+			else if (hasLength && (lengthBits % 8 != 0 || lengthBits / 8 > message.size()))
+			{
+				vectors.skippedCount++;
+			}
+			else if (hasLength)
+			{
+				message.resize((size_t)(lengthBits / 8));
+				vectors.messages.push_back({ message, digest });
+			}
+			else if (!vectors.monteCarloTests.empty())
+			{
+				vectors.monteCarloTests.back().checkpoints.push_back(digest);
+			}
+
+			hasLength = false;
+		}
+	}
+
+	return true;
+}
+
+// Hashes a message with a block kernel, padding it like a context does
+void hashWithBlocksKernel(BlocksKernel kernel, const byte* message, size_t size, Digest& digest)
+{
+	Sha256Context context;
+	initContext(context);
+
+	size_t fullBlocksCount = size / CONTEXT_BLOCK_BYTES;
+	if (fullBlocksCount > 0)
+	{
+		kernel(message, fullBlocksCount, context.state);
+	}
+
+	byte finalBlocks[FINAL_BLOCKS_MAX_BYTES];
+	size_t finalBlocksCount = createFinalBlocks(message + fullBlocksCount * CONTEXT_BLOCK_BYTES, size % CONTEXT_BLOCK_BYTES, size, finalBlocks);
+	kernel(finalBlocks, finalBlocksCount, context.state);
+
+	storeDigest(context.state, digest);
+}
+
+// Hashes up to one message per lane with a multi-buffer kernel
+// Lanes run until their own message ends, the unused and finished lanes hash an idle block
+void hashWithLanesKernel(LanesKernel kernel, size_t lanesCount, const byte* const* messages, const size_t* sizes, size_t count, Digest* digests)
+{
+	Sha256Context initialContext;
+	initContext(initialContext);
+
+	word32 laneStates[CONTEXT_STATE_WORDS * AVX512_LANES_COUNT];
+	byte finalBlocks[AVX512_LANES_COUNT][FINAL_BLOCKS_MAX_BYTES];
+	size_t fullBlocksCounts[AVX512_LANES_COUNT];
+	size_t blocksCounts[AVX512_LANES_COUNT];
+	const byte* laneBlocks[AVX512_LANES_COUNT];
+
+	size_t maxBlocksCount = 0;
+	for (size_t lane = 0; lane < lanesCount; lane++)
+	{
+		for (size_t i = 0; i < CONTEXT_STATE_WORDS; i++)
+		{
+			laneStates[i * lanesCount + lane] = initialContext.state[i];
+		}
+
+		blocksCounts[lane] = 0;
+		if (lane < count)
+		{
+			fullBlocksCounts[lane] = sizes[lane] / CONTEXT_BLOCK_BYTES;
+			blocksCounts[lane] = fullBlocksCounts[lane] + createFinalBlocks(messages[lane] + fullBlocksCounts[lane] * CONTEXT_BLOCK_BYTES,
+				sizes[lane] % CONTEXT_BLOCK_BYTES, sizes[lane], finalBlocks[lane]);
+			maxBlocksCount = blocksCounts[lane] > maxBlocksCount ? blocksCounts[lane] : maxBlocksCount;
+		}
+	}
+
+	for (size_t block = 0; block < maxBlocksCount; block++)
+	{
+		for (size_t lane = 0; lane < lanesCount; lane++)
+		{
+			if (block >= blocksCounts[lane])
+			{
+				laneBlocks[lane] = IDLE_CAVP_BLOCK;
+			}
+			else if (block < fullBlocksCounts[lane])
+			{
+				laneBlocks[lane] = messages[lane] + block * CONTEXT_BLOCK_BYTES;
+			}
+			else
+			{
+				laneBlocks[lane] = finalBlocks[lane] + (block - fullBlocksCounts[lane]) * CONTEXT_BLOCK_BYTES;
+			}
+		}
+
+		kernel(laneBlocks, laneStates);
+
+		for (size_t lane = 0; lane < count && lane < lanesCount; lane++)
+		{
+			if (block + 1 != blocksCounts[lane])
+			{
+				continue;
+			}
+
+			word32 state[CONTEXT_STATE_WORDS];
+			for (size_t i = 0; i < CONTEXT_STATE_WORDS; i++)
+			{
+				state[i] = laneStates[i * lanesCount + lane];
+			}
+			storeDigest(state, digests[lane]);
+		}
+	}
+}
+
+// Hashes a batch of messages with a kernel under test, a multi-buffer kernel takes them a lane count at a time
+void hashWithKernel(const CavpKernel& kernel, const byte* const* messages, const size_t* sizes, size_t count, Digest* digests)
+{
+	if (kernel.blocksKernel != nullptr)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			hashWithBlocksKernel(kernel.blocksKernel, messages[i], sizes[i], digests[i]);
+		}
+		return;
+	}
+
+	for (size_t start = 0; start < count; start += kernel.lanesCount)
+	{
+		size_t batchCount = count - start < kernel.lanesCount ? count - start : kernel.lanesCount;
+		hashWithLanesKernel(kernel.lanesKernel, kernel.lanesCount, messages + start, sizes + start, batchCount, digests + start);
+	}
+}
+
+// Checks the messages of a file with a kernel and reports the first failures
+// Returns the count of failed messages
+size_t checkCavpMessages(const CavpKernel& kernel, const vector<CavpMessage>& messages)
+{
+	vector<const byte*> data(messages.size());
+	vector<size_t> sizes(messages.size());
+	for (size_t i = 0; i < messages.size(); i++)
+	{
+		data[i] = messages[i].bytes.data();
+		sizes[i] = messages[i].bytes.size();
+	}
+
+	vector<Digest> digests(messages.size());
+	hashWithKernel(kernel, data.data(), sizes.data(), messages.size(), digests.data());
+
+	size_t failuresCount = 0;
+	for (size_t i = 0; i < messages.size(); i++)
+	{
+		if (areDigestsEqual(digests[i], messages[i].digest))
+		{
+			continue;
+		}
+
+		if (++failuresCount <= MAX_REPORTED_FAILURES)
+		{
+			cout << "  " << kernel.name << ": the message of " << sizes[i] << " bytes has a wrong digest" << endl;
+		}
+	}
+
+	return failuresCount;
+}
+
+// Runs a Monte Carlo test with a kernel - every lane of a multi-buffer kernel hashes the same chain
+// Returns the count of failed checkpoints
+size_t checkCavpMonteCarlo(const CavpKernel& kernel, const CavpMonteCarlo& test)
+{
+	const size_t LANES_COUNT = kernel.blocksKernel != nullptr ? 1 : kernel.lanesCount;
+
+	byte chain[MONTE_CARLO_CHAIN_DIGESTS * DIGEST_BYTES];
+	const byte* messages[AVX512_LANES_COUNT];
+	size_t sizes[AVX512_LANES_COUNT];
+	for (size_t lane = 0; lane < LANES_COUNT; lane++)
+	{
+		messages[lane] = chain;
+		sizes[lane] = sizeof(chain);
+	}
+
+	size_t failuresCount = 0;
+	Digest seed = test.seed;
+	for (size_t checkpoint = 0; checkpoint < test.checkpoints.size(); checkpoint++)
+	{
+		for (size_t i = 0; i < MONTE_CARLO_CHAIN_DIGESTS; i++)
+		{
+			memcpy(chain + i * DIGEST_BYTES, seed.bytes, DIGEST_BYTES);
+		}
+
+		bool areLanesEqual = true;
+		Digest digests[AVX512_LANES_COUNT];
+		for (size_t iteration = 0; iteration < MONTE_CARLO_ITERATIONS; iteration++)
+		{
+			hashWithKernel(kernel, messages, sizes, LANES_COUNT, digests);
+			for (size_t lane = 1; lane < LANES_COUNT; lane++)
+			{
+				areLanesEqual = areLanesEqual && areDigestsEqual(digests[lane], digests[0]);
+			}
+
+			memmove(chain, chain + DIGEST_BYTES, (MONTE_CARLO_CHAIN_DIGESTS - 1) * DIGEST_BYTES);
+			memcpy(chain + (MONTE_CARLO_CHAIN_DIGESTS - 1) * DIGEST_BYTES, digests[0].bytes, DIGEST_BYTES);
+		}
+
+		seed = digests[0];
+		if (!areLanesEqual || !areDigestsEqual(seed, test.checkpoints[checkpoint]))
+		{
+			if (++failuresCount <= MAX_REPORTED_FAILURES)
+			{
+				cout << "  " << kernel.name << ": Monte Carlo checkpoint " << checkpoint << " has a wrong digest" << endl;
+			}
+
+			seed = test.checkpoints[checkpoint];
+		}
+	}
+
+	return failuresCount;
+}
+
+// Lists the kernels to check - the portable ones and the ones the processor supports
+vector<CavpKernel> getCavpKernels()
+{
+	vector<CavpKernel> kernels;
+	kernels.push_back({ "reference", hashMessageBlocksReference, nullptr, 1 });
+	kernels.push_back({ "fast", hashMessageBlocksFast, nullptr, 1 });
+	kernels.push_back({ "selected", hashMessageBlocks, nullptr, 1 });
+
+	if (isShaNiSupported())
+	{
+		kernels.push_back({ "sha-ni", hashMessageBlocksShaNi, nullptr, 1 });
+	}
+
+	if (isAvx2Supported())
+	{
+		kernels.push_back({ "avx2 x8", nullptr, hashLaneBlocksAvx2, AVX2_LANES_COUNT });
+	}
+
+	if (isAvx512Supported())
+	{
+		kernels.push_back({ "avx512 x16", nullptr, hashLaneBlocksAvx512, AVX512_LANES_COUNT });
+	}
+
+	return kernels;
+}
+
+// Checks every vector of the given response files with every supported kernel and prints a line per file and kernel
+// Returns EXIT_SUCCESS only if every file has vectors and all of them pass
+int runCavp(const char* const* paths, int pathsCount)
+{
+	if (pathsCount < 1)
+	{
+		cerr << "Usage: Sha256 --cavp <response file>..." << endl;
+		return EXIT_FAILURE;
+	}
+
+	vector<CavpKernel> kernels = getCavpKernels();
+	bool success = true;
+	for (int i = 0; i < pathsCount; i++)
+	{
+		CavpVectors vectors;
+		if (!readCavpVectors(paths[i], vectors))
+		{
+			cerr << paths[i] << ": the file can't be read or has a malformed value" << endl;
+			success = false;
+			continue;
+		}
+
+		size_t checkpointsCount = 0;
+		for (const CavpMonteCarlo& test : vectors.monteCarloTests)
+		{
+			checkpointsCount += test.checkpoints.size();
+		}
+
+		size_t vectorsCount = vectors.messages.size() + checkpointsCount;
+		if (vectorsCount == 0)
+		{
+			cerr << paths[i] << ": no SHA-256 vectors found" << endl;
+			success = false;
+			continue;
+		}
+
+		cout << paths[i] << ": " << vectors.messages.size() << " messages, " << checkpointsCount << " Monte Carlo checkpoints";
+		if (vectors.skippedCount > 0)
+		{
+			cout << ", " << vectors.skippedCount << " messages of partial bytes skipped";
+		}
+		cout << endl;
+
+		for (const CavpKernel& kernel : kernels)
+		{
+			size_t failuresCount = checkCavpMessages(kernel, vectors.messages);
+			for (const CavpMonteCarlo& test : vectors.monteCarloTests)
+			{
+				failuresCount += checkCavpMonteCarlo(kernel, test);
+			}
+
+			cout << "  " << kernel.name << ": " << vectorsCount - failuresCount << "/" << vectorsCount << " passed" << endl;
+			success = success && failuresCount == 0;
+		}
+	}
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
\ No newline at end of file
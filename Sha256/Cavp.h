@@ -0,0 +1,19 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the declaration of the NIST CAVP vector runner
+* It checks the ShortMsg, LongMsg and Monte Carlo response files of SHA-256 against every kernel the processor supports
+*
+*/
+
+#pragma once
+
+int runCavp(const char* const* paths, int pathsCount);
\ No newline at end of file
@@ -0,0 +1,174 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the processor feature checks used to select hashing kernels
+*
+*/
+
+#include <cstddef>
+
+#include "CpuFeatures.h"
+
+#ifdef SHA256_X86
+
+#ifdef _MSC_VER
+#include <immintrin.h>
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+const unsigned int CPUID_FEATURES_LEAF = 1;
+const unsigned int CPUID_EXTENDED_FEATURES_LEAF = 7;
+
+const unsigned int SSSE3_BIT = 1u << 9;
+const unsigned int SSE41_BIT = 1u << 19;
+const unsigned int OSXSAVE_BIT = 1u << 27;
+const unsigned int AVX_BIT = 1u << 28;
+const unsigned int AVX2_BIT = 1u << 5;
+const unsigned int AVX512F_BIT = 1u << 16;
+const unsigned int SHA_BIT = 1u << 29;
+
+// The register states the operating system must save for AVX and for AVX-512
+const unsigned long long AVX_STATE_MASK = 0x6;
+const unsigned long long AVX512_STATE_MASK = 0xE6;
+
+// Indexes of the CPUID result registers
+enum CpuidRegisters
+{
+	eax = 0,
+	ebx = 1,
+	ecx = 2,
+	edx = 3
+};
+
+// Reads the given CPUID leaf with subleaf zero into the four result registers
+// Returns false if the processor doesn't support the leaf
+bool readCpuid(unsigned int leaf, unsigned int* registers)
+{
+#ifdef _MSC_VER
+	int maxLeafRegisters[4] = { 0 };
+	__cpuid(maxLeafRegisters, 0);
+	if ((unsigned int)maxLeafRegisters[eax] < leaf)
+	{
+		return false;
+	}
+
+	int leafRegisters[4] = { 0 };
+	__cpuidex(leafRegisters, (int)leaf, 0);
+	for (size_t i = 0; i < 4; i++)
+	{
+		registers[i] = (unsigned int)leafRegisters[i];
+	}
+
+	return true;
+#else
+	if (__get_cpuid_max(0, nullptr) < leaf)
+	{
+		return false;
+	}
+
+	__cpuid_count(leaf, 0, registers[eax], registers[ebx], registers[ecx], registers[edx]);
+	return true;
+#endif
+}
+
+// Reads which register states the operating system saves on context switches
+// Returns zero if the operating system doesn't expose the XGETBV instruction
+unsigned long long readEnabledStates()
+{
+	unsigned int features[4] = { 0 };
+	if (!readCpuid(CPUID_FEATURES_LEAF, features) || !(features[ecx] & OSXSAVE_BIT))
+	{
+		return 0;
+	}
+
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	unsigned int low = 0;
+	unsigned int high = 0;
+	__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+
+	return ((unsigned long long)high << 32) | low;
+#endif
+}
+
+// Checks whether the processor supports the SHA extensions and the SSE versions used with them
+bool isShaNiSupported()
+{
+	unsigned int features[4] = { 0 };
+	unsigned int extendedFeatures[4] = { 0 };
+
+	if (!readCpuid(CPUID_FEATURES_LEAF, features) || !readCpuid(CPUID_EXTENDED_FEATURES_LEAF, extendedFeatures))
+	{
+		return false;
+	}
+
+	bool hasSse = (features[ecx] & SSSE3_BIT) && (features[ecx] & SSE41_BIT);
+	bool hasSha = (extendedFeatures[ebx] & SHA_BIT) != 0;
+
+	return hasSse && hasSha;
+}
+
+// Checks whether the processor supports AVX2 and the operating system saves the 256 bit registers
+bool isAvx2Supported()
+{
+	unsigned int features[4] = { 0 };
+	unsigned int extendedFeatures[4] = { 0 };
+
+	if (!readCpuid(CPUID_FEATURES_LEAF, features) || !readCpuid(CPUID_EXTENDED_FEATURES_LEAF, extendedFeatures))
+	{
+		return false;
+	}
+
+	bool hasAvx = (features[ecx] & AVX_BIT) != 0;
+	bool hasAvx2 = (extendedFeatures[ebx] & AVX2_BIT) != 0;
+
+	return hasAvx && hasAvx2 && (readEnabledStates() & AVX_STATE_MASK) == AVX_STATE_MASK;
+}
+
+// Checks whether the processor supports AVX-512 Foundation and the operating system saves the 512 bit registers
+bool isAvx512Supported()
+{
+	unsigned int extendedFeatures[4] = { 0 };
+
+	if (!isAvx2Supported() || !readCpuid(CPUID_EXTENDED_FEATURES_LEAF, extendedFeatures))
+	{
+		return false;
+	}
+
+	bool hasAvx512 = (extendedFeatures[ebx] & AVX512F_BIT) != 0;
+
+	return hasAvx512 && (readEnabledStates() & AVX512_STATE_MASK) == AVX512_STATE_MASK;
+}
+
+#else
+
+// The SHA extensions are only available on x86 processors
+bool isShaNiSupported()
+{
+	return false;
+}
+
+// AVX2 is only available on x86 processors
+bool isAvx2Supported()
+{
+	return false;
+}
+
+// AVX-512 is only available on x86 processors
+bool isAvx512Supported()
+{
+	return false;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,24 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains declarations of the processor feature checks used to select hashing kernels
+*
+*/
+
+#pragma once
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SHA256_X86
+#endif
+
+bool isShaNiSupported();
+bool isAvx2Supported();
+bool isAvx512Supported();
\ No newline at end of file
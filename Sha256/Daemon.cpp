@@ -0,0 +1,447 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the hashing daemon
+* Every worker runs its own event loop over the shared listening socket and the clients it has accepted
+* The requests that arrive on all of its clients while it waits are hashed together as one multi-buffer batch,
+* so concurrent small requests of many clients share the lanes of the block kernel
+*
+*/
+
+#include <iostream>
+
+#include "Daemon.h"
+
+#ifdef _WIN32
+
+using namespace std;
+
+// The daemon needs Unix domain sockets and poll, so it isn't available on Windows
+bool runHashDaemon(const char* socketPath, unsigned int workersCount)
+{
+	cerr << "The hashing daemon isn't supported on Windows" << endl;
+	return false;
+}
+
+#else
+
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+typedef unsigned char byte;
+
+const size_t DAEMON_READ_BYTES = 64 << 10;
+const size_t MAX_READ_BYTES_PER_ROUND = 1 << 20;
+const size_t MAX_PENDING_OUTPUT_BYTES = 1 << 20;
+const int POLL_TIMEOUT_MILLISECONDS = 200;
+
+// Set by SIGINT and SIGTERM, every worker stops within one poll timeout
+// An atomic, as the workers read it while the signal handler writes it, and a lock-free one, so the handler may write it
+atomic<bool> isDaemonStopping(false);
+
+static_assert(ATOMIC_BOOL_LOCK_FREE == 2, "The stop flag of the daemon must be lock-free to be set in a signal handler");
+
+// A client connection of a worker
+// The received bytes from inputStart on are not parsed yet, the output bytes from outputSent on are not sent yet
+struct DaemonConnection
+{
+	int socket;
+	vector<byte> input;
+	size_t inputStart;
+	vector<byte> output;
+	size_t outputSent;
+	bool isReadClosed;
+	bool isBroken;
+};
+
+// A parsed request whose payload is still in the input of its connection
+struct DaemonRequest
+{
+	size_t connection;
+	byte requestId[4];
+	size_t payloadOffset;
+	size_t payloadSize;
+};
+
+// The batch buffers of a worker, kept between the rounds so they don't allocate again
+struct DaemonBatch
+{
+	vector<DaemonRequest> requests;
+	vector<MessageSpan> spans;
+	vector<Digest> digests;
+};
+
+// Stops the daemon on a signal
+void stopDaemon(int)
+{
+	isDaemonStopping.store(true);
+}
+
+// Switches a socket to non-blocking mode and keeps it from being inherited by child processes
+bool setNonBlocking(int socket)
+{
+	int flags = fcntl(socket, F_GETFL, 0);
+
+	return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0 && fcntl(socket, F_SETFD, FD_CLOEXEC) == 0;
+}
+
+// Reads a big-endian 32 bit number
+unsigned int readBigEndian(const byte* bytes)
+{
+	return ((unsigned int)bytes[0] << 24) | ((unsigned int)bytes[1] << 16) | ((unsigned int)bytes[2] << 8) | bytes[3];
+}
+
+// Accepts every waiting client
+// Several workers wait on the same listening socket, so another one may have taken the client already
+void acceptDaemonClients(int listener, vector<DaemonConnection>& connections)
+{
+	while (true)
+	{
+		int client = accept(listener, nullptr, nullptr);
+		if (client < 0)
+		{
+			return;
+		}
+
+		if (!setNonBlocking(client))
+		{
+			close(client);
+			continue;
+		}
+
+#ifdef SO_NOSIGPIPE
+		int isEnabled = 1;
+		setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &isEnabled, sizeof(isEnabled));
+#endif
+
+		DaemonConnection connection;
+		connection.socket = client;
+		connection.inputStart = 0;
+		connection.outputSent = 0;
+		connection.isReadClosed = false;
+		connection.isBroken = false;
+		connections.push_back(connection);
+	}
+}
+
+// Reads what a client has sent so far, up to MAX_READ_BYTES_PER_ROUND so one client can't hold up the others
+void readDaemonInput(DaemonConnection& connection)
+{
+	size_t roundBytes = 0;
+	while (roundBytes < MAX_READ_BYTES_PER_ROUND)
+	{
+		size_t oldSize = connection.input.size();
+		connection.input.resize(oldSize + DAEMON_READ_BYTES);
+
+		ssize_t bytesRead = recv(connection.socket, connection.input.data() + oldSize, DAEMON_READ_BYTES, 0);
+		connection.input.resize(oldSize + (bytesRead > 0 ? (size_t)bytesRead : 0));
+
+		if (bytesRead == 0)
+		{
+			connection.isReadClosed = true;
+			return;
+		}
+
+		if (bytesRead < 0)
+		{
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+			{
+				connection.isBroken = true;
+			}
+			return;
+		}
+
+		roundBytes += (size_t)bytesRead;
+	}
+}
+
+// Adds every complete request of a connection to the batch
+// A payload size over the limit breaks the connection, as the rest of its stream can't be trusted
+void parseDaemonRequests(DaemonConnection& connection, size_t connectionIndex, DaemonBatch& batch)
+{
+	while (connection.input.size() - connection.inputStart >= DAEMON_REQUEST_HEADER_BYTES)
+	{
+		const byte* header = connection.input.data() + connection.inputStart;
+		size_t payloadSize = readBigEndian(header + 4);
+		if (payloadSize > DAEMON_MAX_PAYLOAD_BYTES)
+		{
+			connection.isBroken = true;
+			return;
+		}
+
+		if (connection.input.size() - connection.inputStart - DAEMON_REQUEST_HEADER_BYTES < payloadSize)
+		{
+			return;
+		}
+
+		DaemonRequest request;
+		request.connection = connectionIndex;
+		memcpy(request.requestId, header, sizeof(request.requestId));
+		request.payloadOffset = connection.inputStart + DAEMON_REQUEST_HEADER_BYTES;
+		request.payloadSize = payloadSize;
+		batch.requests.push_back(request);
+
+		connection.inputStart = request.payloadOffset + payloadSize;
+	}
+}
+
+// Hashes the requests of all connections as one batch and queues the responses
+// The payloads are hashed where they were received, then the parsed bytes are dropped from the inputs
+void hashDaemonBatch(vector<DaemonConnection>& connections, DaemonBatch& batch)
+{
+	size_t count = batch.requests.size();
+	batch.spans.resize(count);
+	batch.digests.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		const DaemonRequest& request = batch.requests[i];
+		batch.spans[i].data = connections[request.connection].input.data() + request.payloadOffset;
+		batch.spans[i].size = request.payloadSize;
+	}
+
+	hashMany(batch.spans.data(), count, batch.digests.data());
+
+	for (size_t i = 0; i < count; i++)
+	{
+		vector<byte>& output = connections[batch.requests[i].connection].output;
+		output.insert(output.end(), batch.requests[i].requestId, batch.requests[i].requestId + sizeof(batch.requests[i].requestId));
+		output.insert(output.end(), batch.digests[i].bytes, batch.digests[i].bytes + DIGEST_BYTES);
+	}
+
+	for (DaemonConnection& connection : connections)
+	{
+		connection.input.erase(connection.input.begin(), connection.input.begin() + connection.inputStart);
+		connection.inputStart = 0;
+	}
+
+	batch.requests.clear();
+}
+
+// Sends as much of the queued responses as the client takes without blocking
+void writeDaemonOutput(DaemonConnection& connection)
+{
+	while (connection.outputSent < connection.output.size())
+	{
+		ssize_t bytesSent = send(connection.socket, connection.output.data() + connection.outputSent, connection.output.size() - connection.outputSent, 0);
+		if (bytesSent < 0)
+		{
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+			{
+				connection.isBroken = true;
+			}
+			break;
+		}
+
+		connection.outputSent += (size_t)bytesSent;
+	}
+
+	if (connection.outputSent == connection.output.size())
+	{
+		connection.output.clear();
+		connection.outputSent = 0;
+	}
+}
+
+// Checks whether a connection is done - broken, or closed by the client with every response sent
+bool isConnectionFinished(const DaemonConnection& connection)
+{
+	return connection.isBroken || (connection.isReadClosed && connection.output.empty());
+}
+
+// Runs the event loop of one worker until the daemon is stopped
+// A client with too many unsent responses isn't read from until it takes them
+void runDaemonWorker(int listener)
+{
+	vector<DaemonConnection> connections;
+	vector<pollfd> pollFds;
+	DaemonBatch batch;
+
+	while (!isDaemonStopping.load())
+	{
+		pollFds.resize(connections.size() + 1);
+		pollFds[0].fd = listener;
+		pollFds[0].events = POLLIN;
+		for (size_t i = 0; i < connections.size(); i++)
+		{
+			const DaemonConnection& connection = connections[i];
+			bool isReading = !connection.isReadClosed && connection.output.size() < MAX_PENDING_OUTPUT_BYTES;
+
+			pollFds[i + 1].fd = connection.socket;
+			pollFds[i + 1].events = (short)((isReading ? POLLIN : 0) | (connection.output.empty() ? 0 : POLLOUT));
+		}
+
+		if (poll(pollFds.data(), pollFds.size(), POLL_TIMEOUT_MILLISECONDS) < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			break;
+		}
+
+		for (size_t i = 0; i < connections.size(); i++)
+		{
+			if (pollFds[i + 1].revents & (POLLIN | POLLHUP | POLLERR))
+			{
+				readDaemonInput(connections[i]);
+				parseDaemonRequests(connections[i], i, batch);
+			}
+		}
+
+		if (!batch.requests.empty())
+		{
+			hashDaemonBatch(connections, batch);
+		}
+
+		for (size_t i = 0; i < connections.size(); i++)
+		{
+			if (!connections[i].output.empty() && !connections[i].isBroken)
+			{
+				writeDaemonOutput(connections[i]);
+			}
+		}
+
+		size_t keptCount = 0;
+		for (size_t i = 0; i < connections.size(); i++)
+		{
+			if (isConnectionFinished(connections[i]))
+			{
+				close(connections[i].socket);
+				continue;
+			}
+
+			if (keptCount != i)
+			{
+				connections[keptCount] = move(connections[i]);
+			}
+			keptCount++;
+		}
+		connections.resize(keptCount);
+
+		if (pollFds[0].revents & POLLIN)
+		{
+			acceptDaemonClients(listener, connections);
+		}
+	}
+
+	for (DaemonConnection& connection : connections)
+	{
+		close(connection.socket);
+	}
+}
+
+// Checks whether nothing listens on a socket that is left at a path - connecting to it is refused
+// A socket that accepts the connection, or can't be checked, belongs to a running daemon and is kept
+bool isStaleSocket(const sockaddr_un& address)
+{
+	int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (probe < 0)
+	{
+		return false;
+	}
+
+	bool isStale = connect(probe, (const sockaddr*)&address, sizeof(address)) != 0 && errno == ECONNREFUSED;
+	close(probe);
+	return isStale;
+}
+
+// Creates the listening socket at the given path
+// A socket left at the path by a daemon that didn't stop cleanly is replaced
+// A socket of a running daemon and any other file are kept
+// Returns -1 if the socket can't be created
+int openDaemonListener(const char* socketPath)
+{
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (strlen(socketPath) >= sizeof(address.sun_path))
+	{
+		cerr << socketPath << ": the socket path is too long" << endl;
+		return -1;
+	}
+	strcpy(address.sun_path, socketPath);
+
+	struct stat fileInfo;
+	if (lstat(socketPath, &fileInfo) == 0 && S_ISSOCK(fileInfo.st_mode))
+	{
+		if (!isStaleSocket(address))
+		{
+			cerr << socketPath << ": a daemon is already running on this socket" << endl;
+			return -1;
+		}
+		unlink(socketPath);
+	}
+
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener < 0)
+	{
+		return -1;
+	}
+
+	if (bind(listener, (const sockaddr*)&address, sizeof(address)) != 0 || listen(listener, SOMAXCONN) != 0 || !setNonBlocking(listener))
+	{
+		close(listener);
+		return -1;
+	}
+
+	return listener;
+}
+
+// Runs the daemon on the given socket path with the given amount of workers until SIGINT or SIGTERM
+// Returns false if the socket can't be created
+bool runHashDaemon(const char* socketPath, unsigned int workersCount)
+{
+	int listener = openDaemonListener(socketPath);
+	if (listener < 0)
+	{
+		cerr << socketPath << ": the socket couldn't be created" << endl;
+		return false;
+	}
+
+	isDaemonStopping.store(false);
+	signal(SIGPIPE, SIG_IGN);
+	signal(SIGINT, stopDaemon);
+	signal(SIGTERM, stopDaemon);
+
+	cerr << "Hashing requests on " << socketPath << " with " << workersCount << " workers" << endl;
+
+	vector<thread> workers;
+	for (unsigned int i = 1; i < workersCount; i++)
+	{
+		workers.emplace_back(runDaemonWorker, listener);
+	}
+	runDaemonWorker(listener);
+
+	for (thread& worker : workers)
+	{
+		worker.join();
+	}
+
+	close(listener);
+	unlink(socketPath);
+	return true;
+}
+
+#endif
\ No newline at end of file
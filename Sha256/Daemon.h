@@ -0,0 +1,31 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the declarations of the hashing daemon
+* Clients connect to a Unix domain socket and send any number of requests, each one a header and a payload:
+*   4 bytes - a request id chosen by the client, returned unchanged with the digest
+*   4 bytes - the payload size, at most DAEMON_MAX_PAYLOAD_BYTES
+* Both header fields are big-endian. Every request is answered with the request id and the 32 byte digest
+* of the payload, in the order the requests were sent on the connection
+*
+*/
+
+#pragma once
+
+#include <cstddef>
+
+#include "SHA256.h"
+
+const size_t DAEMON_REQUEST_HEADER_BYTES = 8;
+const size_t DAEMON_RESPONSE_BYTES = 4 + DIGEST_BYTES;
+const size_t DAEMON_MAX_PAYLOAD_BYTES = 16 << 20;
+
+bool runHashDaemon(const char* socketPath, unsigned int workersCount);
\ No newline at end of file
@@ -0,0 +1,569 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the chunk deduplication index
+* The chunk boundaries are found with a gear rolling hash (FastCDC), so an insertion in a file only moves
+* the boundaries next to it, and the chunks of a whole read window are hashed together over the multi-buffer lanes
+* The table file is memory-mapped in the native byte order, so it is only meant to be used on the machine that wrote it
+*
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Dedup.h"
+#include "FileHashing.h"
+#include "Manifest.h"
+#include "Sha256Constexpr.h"
+
+using namespace std;
+
+typedef unsigned char byte;
+
+const char DEDUP_INDEX_MAGIC[] = "SHA2DDX1";
+const size_t DEDUP_INDEX_MAGIC_SIZE = 8;
+const char* FILE_PATHS_SUFFIX = ".paths";
+const char* GROWN_INDEX_SUFFIX = ".new";
+
+const unsigned long long INITIAL_SLOTS_COUNT = 1 << 16;
+const unsigned long long MAX_LOAD_PERCENT = 70;
+const size_t DEDUP_READ_BYTES = 4 << 20;
+
+// The gear hash masks of FastCDC for 8 KiB chunks - the stricter one is used before the average chunk size
+const unsigned long long SMALL_CHUNK_MASK = 0x0003590703530000ULL;
+const unsigned long long LARGE_CHUNK_MASK = 0x0000d90003530000ULL;
+
+// The start of the index file
+struct DedupIndexHeader
+{
+	char magic[DEDUP_INDEX_MAGIC_SIZE];
+	unsigned long long slotsCount;
+	unsigned long long usedSlotsCount;
+	unsigned long long reserved;
+};
+
+// A slot of the table - a slot without references is empty
+struct DedupSlot
+{
+	Digest digest;
+	unsigned long long offset;
+	unsigned long long referencesCount;
+	unsigned int size;
+	unsigned int fileId;
+	unsigned long long reserved;
+};
+
+// The random value of every byte for the gear rolling hash
+struct GearTable
+{
+	unsigned long long values[256];
+};
+
+// Builds the gear table at compile time from a fixed seed with the SplitMix64 generator
+constexpr GearTable createGearTable()
+{
+	GearTable table = { { 0 } };
+
+	unsigned long long seed = 0;
+	for (size_t i = 0; i < 256; i++)
+	{
+		seed += 0x9e3779b97f4a7c15ULL;
+
+		unsigned long long value = seed;
+		value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+		table.values[i] = value ^ (value >> 31);
+	}
+
+	return table;
+}
+
+constexpr GearTable GEAR_TABLE = createGearTable();
+
+// Returns the size of the index file for the given amount of slots
+unsigned long long getIndexFileSize(unsigned long long slotsCount)
+{
+	return sizeof(DedupIndexHeader) + slotsCount * sizeof(DedupSlot);
+}
+
+DedupIndexHeader* getIndexHeader(const DedupIndex& index)
+{
+	return reinterpret_cast<DedupIndexHeader*>(index.data);
+}
+
+DedupSlot* getIndexSlots(const DedupIndex& index)
+{
+	return reinterpret_cast<DedupSlot*>(index.data + sizeof(DedupIndexHeader));
+}
+
+#ifdef _WIN32
+
+// Opens or creates a file, extends it with zeros to at least the given size and maps all of it
+// Returns false if the file can't be opened or mapped
+bool mapIndexFile(DedupIndex& index, const string& path, unsigned long long minimumSize)
+{
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	bool success = GetFileSizeEx(file, &fileSize) != 0;
+	if (success && (unsigned long long)fileSize.QuadPart < minimumSize)
+	{
+		fileSize.QuadPart = (LONGLONG)minimumSize;
+		success = SetFilePointerEx(file, fileSize, nullptr, FILE_BEGIN) && SetEndOfFile(file);
+	}
+
+	HANDLE mapping = success ? CreateFileMappingA(file, nullptr, PAGE_READWRITE, 0, 0, nullptr) : nullptr;
+	void* view = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0) : nullptr;
+	if (view == nullptr)
+	{
+		if (mapping != nullptr)
+		{
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+		return false;
+	}
+
+	index.file = file;
+	index.mapping = mapping;
+	index.data = static_cast<byte*>(view);
+	index.size = (unsigned long long)fileSize.QuadPart;
+	return true;
+}
+
+// Unmaps and closes the index file
+void unmapIndexFile(DedupIndex& index)
+{
+	UnmapViewOfFile(index.data);
+	CloseHandle(index.mapping);
+	CloseHandle(index.file);
+	index.data = nullptr;
+}
+
+#else
+
+// Opens or creates a file, extends it with zeros to at least the given size and maps all of it
+// Returns false if the file can't be opened or mapped
+bool mapIndexFile(DedupIndex& index, const string& path, unsigned long long minimumSize)
+{
+	int descriptor = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+	if (descriptor < 0)
+	{
+		return false;
+	}
+
+	struct stat fileInfo;
+	bool success = fstat(descriptor, &fileInfo) == 0;
+	unsigned long long fileSize = success ? (unsigned long long)fileInfo.st_size : 0;
+	if (success && fileSize < minimumSize)
+	{
+		success = ftruncate(descriptor, (off_t)minimumSize) == 0;
+		fileSize = minimumSize;
+	}
+
+	void* view = success ? mmap(nullptr, (size_t)fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0) : MAP_FAILED;
+	if (view == MAP_FAILED)
+	{
+		close(descriptor);
+		return false;
+	}
+
+	index.descriptor = descriptor;
+	index.data = static_cast<byte*>(view);
+	index.size = fileSize;
+	return true;
+}
+
+// Unmaps and closes the index file
+void unmapIndexFile(DedupIndex& index)
+{
+	munmap(index.data, (size_t)index.size);
+	close(index.descriptor);
+	index.data = nullptr;
+}
+
+#endif
+
+// Checks whether the mapped file is an index with a whole table
+bool isValidIndexFile(const DedupIndex& index)
+{
+	if (index.size < sizeof(DedupIndexHeader))
+	{
+		return false;
+	}
+
+	const DedupIndexHeader* header = getIndexHeader(index);
+	for (size_t i = 0; i < DEDUP_INDEX_MAGIC_SIZE; i++)
+	{
+		if (header->magic[i] != DEDUP_INDEX_MAGIC[i])
+		{
+			return false;
+		}
+	}
+
+	unsigned long long slotsCount = header->slotsCount;
+	bool isPowerOfTwo = slotsCount != 0 && (slotsCount & (slotsCount - 1)) == 0;
+
+	return isPowerOfTwo && index.size >= getIndexFileSize(slotsCount);
+}
+
+// Writes the header of an empty index with the given amount of slots
+void initIndexHeader(DedupIndex& index, unsigned long long slotsCount)
+{
+	DedupIndexHeader* header = getIndexHeader(index);
+	for (size_t i = 0; i < DEDUP_INDEX_MAGIC_SIZE; i++)
+	{
+		header->magic[i] = DEDUP_INDEX_MAGIC[i];
+	}
+	header->slotsCount = slotsCount;
+	header->usedSlotsCount = 0;
+	header->reserved = 0;
+}
+
+// Finds the slot of a digest or the empty slot where it belongs
+// The digests are already uniformly distributed, so their first bytes are used as the slot hash
+DedupSlot* findDedupSlot(const DedupIndex& index, const Digest& digest)
+{
+	unsigned long long slotHash = 0;
+	for (size_t i = 0; i < sizeof(slotHash); i++)
+	{
+		slotHash = (slotHash << 8) | digest.bytes[i];
+	}
+
+	DedupSlot* slots = getIndexSlots(index);
+	unsigned long long mask = getIndexHeader(index)->slotsCount - 1;
+	unsigned long long position = slotHash & mask;
+
+	while (slots[position].referencesCount != 0 && !areDigestsEqual(slots[position].digest, digest))
+	{
+		position = (position + 1) & mask;
+	}
+
+	return &slots[position];
+}
+
+// Moves the index to a new file with twice the slots, which then replaces the old file
+// The old file stays unchanged until the new one is complete
+bool growDedupIndex(DedupIndex& index)
+{
+	string grownPath = index.path + GROWN_INDEX_SUFFIX;
+	remove(grownPath.c_str());
+
+	unsigned long long slotsCount = getIndexHeader(index)->slotsCount * 2;
+
+	DedupIndex grown;
+	if (!mapIndexFile(grown, grownPath, getIndexFileSize(slotsCount)))
+	{
+		return false;
+	}
+
+	initIndexHeader(grown, slotsCount);
+
+	const DedupSlot* slots = getIndexSlots(index);
+	unsigned long long oldSlotsCount = getIndexHeader(index)->slotsCount;
+	for (unsigned long long i = 0; i < oldSlotsCount; i++)
+	{
+		if (slots[i].referencesCount != 0)
+		{
+			*findDedupSlot(grown, slots[i].digest) = slots[i];
+		}
+	}
+	getIndexHeader(grown)->usedSlotsCount = getIndexHeader(index)->usedSlotsCount;
+
+	unmapIndexFile(grown);
+	unmapIndexFile(index);
+
+	bool isReplaced = replaceFile(grownPath.c_str(), index.path.c_str());
+	bool isMapped = mapIndexFile(index, index.path, 0);
+
+	return isReplaced && isMapped && isValidIndexFile(index);
+}
+
+// Looks up a chunk and adds it to the index if it isn't there yet
+// A chunk found at its own file and offset is the same chunk scanned again, so it isn't a duplicate and isn't counted
+// Returns false if the index couldn't grow, otherwise tells whether the chunk is a duplicate and where it was first seen
+bool addDedupChunk(DedupIndex& index, const Digest& digest, const DedupChunkLocation& location, bool& isDuplicate, DedupChunkLocation& firstLocation)
+{
+	DedupIndexHeader* header = getIndexHeader(index);
+	if ((header->usedSlotsCount + 1) * 100 > header->slotsCount * MAX_LOAD_PERCENT)
+	{
+		if (!growDedupIndex(index))
+		{
+			return false;
+		}
+		header = getIndexHeader(index);
+	}
+
+	DedupSlot* slot = findDedupSlot(index, digest);
+	if (slot->referencesCount != 0 && slot->fileId == location.fileId && slot->offset == location.offset)
+	{
+		isDuplicate = false;
+		return true;
+	}
+
+	isDuplicate = slot->referencesCount != 0;
+	if (isDuplicate)
+	{
+		firstLocation.fileId = slot->fileId;
+		firstLocation.offset = slot->offset;
+		firstLocation.size = slot->size;
+		slot->referencesCount++;
+		return true;
+	}
+
+	slot->digest = digest;
+	slot->offset = location.offset;
+	slot->size = location.size;
+	slot->fileId = location.fileId;
+	slot->reserved = 0;
+	slot->referencesCount = 1;
+	header->usedSlotsCount++;
+
+	return true;
+}
+
+// Finds the id of a scanned file path, adding the path to the paths file if it is new
+// A path with a backslash or a line end is written escaped after a backslash, like a manifest line, so it stays on one line
+// Returns false if the paths file can't be written
+bool getDedupFileId(DedupIndex& index, const char* path, unsigned int& fileId)
+{
+	unordered_map<string, unsigned int>::const_iterator knownFile = index.fileIds.find(path);
+	if (knownFile != index.fileIds.end())
+	{
+		fileId = knownFile->second;
+		return true;
+	}
+
+	ofstream pathsFile(index.path + FILE_PATHS_SUFFIX, ios::app);
+	if (isPathEscaped(path))
+	{
+		pathsFile << '\\' << escapePath(path) << '\n';
+	}
+	else
+	{
+		pathsFile << path << '\n';
+	}
+
+	if (!pathsFile)
+	{
+		return false;
+	}
+
+	fileId = (unsigned int)index.filePaths.size();
+	index.filePaths.push_back(path);
+	index.fileIds[path] = fileId;
+	return true;
+}
+
+// Opens an index file or creates an empty one, together with its file paths
+// A path line that starts with a backslash is unescaped, and kept as it is if it isn't a valid escaped path
+// Returns false if the file can't be mapped or isn't an index
+bool openDedupIndex(const char* path, DedupIndex& index)
+{
+	index.path = path;
+	index.filePaths.clear();
+	index.fileIds.clear();
+
+	if (!mapIndexFile(index, index.path, getIndexFileSize(INITIAL_SLOTS_COUNT)))
+	{
+		return false;
+	}
+
+	DedupIndexHeader* header = getIndexHeader(index);
+	if (header->slotsCount == 0 && header->magic[0] == 0)
+	{
+		initIndexHeader(index, INITIAL_SLOTS_COUNT);
+	}
+
+	if (!isValidIndexFile(index))
+	{
+		unmapIndexFile(index);
+		return false;
+	}
+
+	ifstream pathsFile(index.path + FILE_PATHS_SUFFIX);
+	string filePath;
+	while (getline(pathsFile, filePath))
+	{
+		if (!filePath.empty() && filePath[0] == '\\')
+		{
+			string escapedPath = filePath.substr(1);
+			if (unescapePath(&escapedPath[0]))
+			{
+				filePath = escapedPath.c_str();
+			}
+		}
+
+		index.fileIds[filePath] = (unsigned int)index.filePaths.size();
+		index.filePaths.push_back(filePath);
+	}
+
+	return true;
+}
+
+// Unmaps and closes an index, the changes are already in the file
+void closeDedupIndex(DedupIndex& index)
+{
+	if (index.data != nullptr)
+	{
+		unmapIndexFile(index);
+	}
+}
+
+// Returns how many different chunks the index holds
+unsigned long long getDedupUniqueChunksCount(const DedupIndex& index)
+{
+	return getIndexHeader(index)->usedSlotsCount;
+}
+
+// Finds the size of the next chunk at the start of the data
+// The data must hold at least DEDUP_MAX_CHUNK_BYTES bytes unless it is the end of the file
+size_t findChunkEnd(const unsigned char* data, size_t size)
+{
+	if (size <= DEDUP_MIN_CHUNK_BYTES)
+	{
+		return size;
+	}
+
+	size_t limit = min(size, DEDUP_MAX_CHUNK_BYTES);
+	size_t normalLimit = min(limit, DEDUP_AVERAGE_CHUNK_BYTES);
+
+	unsigned long long hash = 0;
+	size_t i = DEDUP_MIN_CHUNK_BYTES;
+	for (; i < normalLimit; i++)
+	{
+		hash = (hash << 1) + GEAR_TABLE.values[data[i]];
+		if ((hash & SMALL_CHUNK_MASK) == 0)
+		{
+			return i + 1;
+		}
+	}
+
+	for (; i < limit; i++)
+	{
+		hash = (hash << 1) + GEAR_TABLE.values[data[i]];
+		if ((hash & LARGE_CHUNK_MASK) == 0)
+		{
+			return i + 1;
+		}
+	}
+
+	return limit;
+}
+
+// Splits a file into chunks, hashes them and adds them to the index
+// Fills in the chunk counts and, if a list is given, where each duplicate chunk was first seen
+// Returns false if the file can't be read or the index can't be updated
+bool addFileToDedupIndex(DedupIndex& index, const char* path, DedupFileStats& stats, vector<DedupDuplicate>* duplicates)
+{
+	stats.chunksCount = 0;
+	stats.bytesCount = 0;
+	stats.duplicateChunksCount = 0;
+	stats.duplicateBytesCount = 0;
+
+	unsigned int fileId = 0;
+	ReadableFile file;
+	if (!openReadableFile(path, file))
+	{
+		return false;
+	}
+
+	if (!getDedupFileId(index, path, fileId))
+	{
+		closeReadableFile(file);
+		return false;
+	}
+
+	vector<byte> buffer(DEDUP_READ_BYTES);
+	vector<MessageSpan> chunks;
+	vector<Digest> digests;
+
+	unsigned long long bufferOffset = 0;
+	size_t filledBytes = 0;
+	bool isEnd = false;
+	bool success = true;
+
+	while (success)
+	{
+		size_t missingBytes = buffer.size() - filledBytes;
+		long long bytesRead = readFileAt(file, bufferOffset + filledBytes, buffer.data() + filledBytes, missingBytes);
+		if (bytesRead < 0)
+		{
+			success = false;
+			break;
+		}
+		filledBytes += (size_t)bytesRead;
+		isEnd = (size_t)bytesRead < missingBytes;
+
+		chunks.clear();
+		size_t position = 0;
+		while (position < filledBytes && (isEnd || filledBytes - position >= DEDUP_MAX_CHUNK_BYTES))
+		{
+			size_t chunkSize = findChunkEnd(buffer.data() + position, filledBytes - position);
+			chunks.push_back({ buffer.data() + position, chunkSize });
+			position += chunkSize;
+		}
+
+		digests.resize(chunks.size());
+		hashMany(chunks.data(), chunks.size(), digests.data());
+
+		for (size_t i = 0; i < chunks.size() && success; i++)
+		{
+			DedupDuplicate duplicate;
+			duplicate.chunk.fileId = fileId;
+			duplicate.chunk.offset = bufferOffset + (unsigned long long)(static_cast<const byte*>(chunks[i].data) - buffer.data());
+			duplicate.chunk.size = (unsigned int)chunks[i].size;
+
+			bool isDuplicate = false;
+			success = addDedupChunk(index, digests[i], duplicate.chunk, isDuplicate, duplicate.firstChunk);
+
+			stats.chunksCount++;
+			stats.bytesCount += chunks[i].size;
+			if (success && isDuplicate)
+			{
+				stats.duplicateChunksCount++;
+				stats.duplicateBytesCount += chunks[i].size;
+				if (duplicates != nullptr)
+				{
+					duplicates->push_back(duplicate);
+				}
+			}
+		}
+
+		copy(buffer.begin() + position, buffer.begin() + filledBytes, buffer.begin());
+		bufferOffset += position;
+		filledBytes -= position;
+
+		if (isEnd && filledBytes == 0)
+		{
+			break;
+		}
+	}
+
+	closeReadableFile(file);
+	return success;
+}
\ No newline at end of file
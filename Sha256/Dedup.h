@@ -0,0 +1,76 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the declarations of the chunk deduplication index
+* Files are split into chunks at content-defined boundaries and each chunk is looked up by its SHA256 hash
+*
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "SHA256.h"
+
+const size_t DEDUP_MIN_CHUNK_BYTES = 2 << 10;
+const size_t DEDUP_AVERAGE_CHUNK_BYTES = 8 << 10;
+const size_t DEDUP_MAX_CHUNK_BYTES = 64 << 10;
+
+// Where a chunk is found in the scanned files
+struct DedupChunkLocation
+{
+	unsigned int fileId;
+	unsigned long long offset;
+	unsigned int size;
+};
+
+// A chunk of a file that has the same hash as an earlier chunk
+struct DedupDuplicate
+{
+	DedupChunkLocation chunk;
+	DedupChunkLocation firstChunk;
+};
+
+// The chunks of a file and how many of them were already in the index
+struct DedupFileStats
+{
+	unsigned long long chunksCount;
+	unsigned long long bytesCount;
+	unsigned long long duplicateChunksCount;
+	unsigned long long duplicateBytesCount;
+};
+
+// An open-addressing table of chunk hashes in a memory-mapped file
+// The scanned file paths are kept next to it, one per line, and the chunk locations refer to them by line
+struct DedupIndex
+{
+	std::string path;
+#ifdef _WIN32
+	void* file;
+	void* mapping;
+#else
+	int descriptor;
+#endif
+	unsigned char* data;
+	unsigned long long size;
+	std::vector<std::string> filePaths;
+	std::unordered_map<std::string, unsigned int> fileIds;
+};
+
+bool openDedupIndex(const char* path, DedupIndex& index);
+void closeDedupIndex(DedupIndex& index);
+unsigned long long getDedupUniqueChunksCount(const DedupIndex& index);
+
+size_t findChunkEnd(const unsigned char* data, size_t size);
+bool addFileToDedupIndex(DedupIndex& index, const char* path, DedupFileStats& stats, std::vector<DedupDuplicate>* duplicates);
\ No newline at end of file
@@ -0,0 +1,275 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the persistent digest cache
+* The cache is a log of fixed size records, each appended with a single write and protected by check bytes
+* Loading keeps the last record of every file, and the log is rewritten and swapped in when it holds
+* mostly replaced records or a torn one
+*
+*/
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+
+#include "DigestCache.h"
+#include "Sha256Constexpr.h"
+
+using namespace std;
+
+const unsigned long long WHOLE_FILE = (unsigned long long)-1;
+const char* COMPACTED_CACHE_SUFFIX = ".new";
+const size_t RECORD_CHECK_BYTES = 8;
+
+// The log is compacted when it holds more than this many records per cached file and at least the minimum records
+const size_t MAX_RECORDS_PER_ENTRY = 2;
+const size_t MIN_COMPACTED_RECORDS = 1024;
+
+// A file modified this shortly before it is hashed may change again within the same timestamp, so it isn't cached
+const unsigned long long SETTLING_NANOSECONDS = 2000000000ULL;
+
+// A record of the log - a later record of the same file replaces the earlier ones
+struct DigestCacheRecord
+{
+	unsigned long long device;
+	unsigned long long inode;
+	unsigned long long size;
+	unsigned long long modifiedNanoseconds;
+	Digest digest;
+	unsigned char check[RECORD_CHECK_BYTES];
+};
+
+// Calculates the check bytes of a record from all of its other fields
+void getRecordCheck(const DigestCacheRecord& record, unsigned char* check)
+{
+	Digest recordDigest;
+	hashBytesDigest(reinterpret_cast<const unsigned char*>(&record), offsetof(DigestCacheRecord, check), recordDigest);
+
+	for (size_t i = 0; i < RECORD_CHECK_BYTES; i++)
+	{
+		check[i] = recordDigest.bytes[i];
+	}
+}
+
+// Checks whether a record has been written whole
+bool isValidRecord(const DigestCacheRecord& record)
+{
+	unsigned char check[RECORD_CHECK_BYTES];
+	getRecordCheck(record, check);
+
+	for (size_t i = 0; i < RECORD_CHECK_BYTES; i++)
+	{
+		if (check[i] != record.check[i])
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Fills a record with a cached digest and its check bytes
+void fillRecord(const DigestCacheKey& key, const DigestCacheEntry& entry, DigestCacheRecord& record)
+{
+	record.device = key.device;
+	record.inode = key.inode;
+	record.size = entry.size;
+	record.modifiedNanoseconds = entry.modifiedNanoseconds;
+	record.digest = entry.digest;
+	getRecordCheck(record, record.check);
+}
+
+// Reads the records of a log into the cache
+// Returns the count of read records and whether every record was whole
+size_t loadRecords(FILE* file, DigestCache& cache, bool& isClean)
+{
+	isClean = true;
+	size_t recordsCount = 0;
+
+	DigestCacheRecord record;
+	size_t bytesRead = 0;
+	while ((bytesRead = fread(&record, 1, sizeof(record), file)) == sizeof(record))
+	{
+		if (!isValidRecord(record))
+		{
+			isClean = false;
+			continue;
+		}
+
+		DigestCacheKey key = { record.device, record.inode };
+		DigestCacheEntry entry = { record.size, record.modifiedNanoseconds, record.digest };
+		cache.entries[key] = entry;
+		recordsCount++;
+	}
+
+	if (bytesRead != 0)
+	{
+		isClean = false;
+	}
+
+	return recordsCount;
+}
+
+// Writes every cached digest to a new log, which then replaces the old one
+// Returns false if the new log can't be written
+bool compactDigestCache(DigestCache& cache)
+{
+	string compactedPath = cache.path + COMPACTED_CACHE_SUFFIX;
+	FILE* compacted = fopen(compactedPath.c_str(), "wb");
+	if (compacted == nullptr)
+	{
+		return false;
+	}
+
+	bool success = true;
+	for (const pair<const DigestCacheKey, DigestCacheEntry>& cached : cache.entries)
+	{
+		DigestCacheRecord record;
+		fillRecord(cached.first, cached.second, record);
+		success = fwrite(&record, sizeof(record), 1, compacted) == 1 && success;
+	}
+
+	success = fclose(compacted) == 0 && success;
+	if (!success)
+	{
+		remove(compactedPath.c_str());
+		return false;
+	}
+
+	return replaceFile(compactedPath.c_str(), cache.path.c_str());
+}
+
+// Adds a digest to the cache and appends its record to the log
+// A failed write only loses the record, the cache still answers from memory
+void storeCachedDigest(DigestCache& cache, const DigestCacheKey& key, const DigestCacheEntry& entry)
+{
+	DigestCacheRecord record;
+	fillRecord(key, entry, record);
+
+	lock_guard<mutex> lock(cache.mutex);
+	cache.entries[key] = entry;
+	fwrite(&record, sizeof(record), 1, cache.log);
+	fflush(cache.log);
+}
+
+// Returns the current time in nanoseconds since the Unix epoch
+unsigned long long getNowNanoseconds()
+{
+	return (unsigned long long)chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Checks whether two identities are of the same version of the same file
+bool areIdentitiesEqual(const FileIdentity& first, const FileIdentity& second)
+{
+	return first.device == second.device &&
+		first.inode == second.inode &&
+		first.size == second.size &&
+		first.modifiedNanoseconds == second.modifiedNanoseconds;
+}
+
+// Loads a cache log, or starts an empty one if there is none, and opens it for appending
+// Returns false if the log can't be opened or a damaged log can't be rewritten
+bool openDigestCache(const char* path, DigestCache& cache)
+{
+	cache.path = path;
+	cache.entries.clear();
+	cache.log = nullptr;
+
+	size_t recordsCount = 0;
+	bool isClean = true;
+
+	FILE* file = fopen(path, "rb");
+	if (file != nullptr)
+	{
+		recordsCount = loadRecords(file, cache, isClean);
+		fclose(file);
+	}
+
+	bool isOversized = recordsCount > MIN_COMPACTED_RECORDS && recordsCount > MAX_RECORDS_PER_ENTRY * cache.entries.size();
+	if ((!isClean || isOversized) && !compactDigestCache(cache) && !isClean)
+	{
+		return false;
+	}
+
+	cache.log = fopen(path, "ab");
+	return cache.log != nullptr;
+}
+
+// Closes the log of a cache, every record is already written
+void closeDigestCache(DigestCache& cache)
+{
+	if (cache.log != nullptr)
+	{
+		fclose(cache.log);
+		cache.log = nullptr;
+	}
+}
+
+// Finds the digest of a whole file, from the cache if the file hasn't changed since it was cached
+// In verify mode the file is always read, and a file that no longer matches its cached digest is reported
+// The file is read with the given hash function, and the new digest is cached only if the file hasn't changed
+// while being read and wasn't modified just before
+CachedHashSource hashFileCached(DigestCache& cache, const char* path, bool isVerifying, FileDigestFunction hashFunction, Digest& digest)
+{
+	FileIdentity identity;
+	if (!getFileIdentity(path, identity))
+	{
+		return HASH_UNREADABLE;
+	}
+
+	DigestCacheKey key = { identity.device, identity.inode };
+	DigestCacheEntry cached;
+	bool isCached = false;
+	{
+		lock_guard<mutex> lock(cache.mutex);
+		unordered_map<DigestCacheKey, DigestCacheEntry, DigestCacheKeyHash>::const_iterator found = cache.entries.find(key);
+		if (found != cache.entries.end())
+		{
+			cached = found->second;
+			isCached = cached.size == identity.size && cached.modifiedNanoseconds == identity.modifiedNanoseconds;
+		}
+	}
+
+	if (isCached && !isVerifying)
+	{
+		digest = cached.digest;
+		return HASH_FROM_CACHE;
+	}
+
+	unsigned long long startNanoseconds = getNowNanoseconds();
+	if (!hashFunction(path, WHOLE_FILE, digest))
+	{
+		return HASH_UNREADABLE;
+	}
+
+	FileIdentity finalIdentity;
+	bool isUnchanged = getFileIdentity(path, finalIdentity) && areIdentitiesEqual(identity, finalIdentity);
+	if (!isUnchanged)
+	{
+		return HASH_FROM_FILE;
+	}
+
+	if (isCached && !areDigestsEqual(cached.digest, digest))
+	{
+		DigestCacheEntry entry = { identity.size, identity.modifiedNanoseconds, digest };
+		storeCachedDigest(cache, key, entry);
+		return HASH_CACHE_MISMATCH;
+	}
+
+	bool isSettled = identity.modifiedNanoseconds + SETTLING_NANOSECONDS < startNanoseconds;
+	if (!isCached && isSettled)
+	{
+		DigestCacheEntry entry = { identity.size, identity.modifiedNanoseconds, digest };
+		storeCachedDigest(cache, key, entry);
+	}
+
+	return HASH_FROM_FILE;
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the declarations of the persistent digest cache
+* A file whose device, inode, size and modification time haven't changed is answered without being read
+*
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "FileHashing.h"
+#include "SHA256.h"
+
+// Where the digest of a file comes from
+enum CachedHashSource
+{
+	HASH_UNREADABLE,
+	HASH_FROM_CACHE,
+	HASH_FROM_FILE,
+	HASH_CACHE_MISMATCH
+};
+
+// The device and inode of a file - a file has at most one cached digest
+struct DigestCacheKey
+{
+	unsigned long long device;
+	unsigned long long inode;
+
+	bool operator==(const DigestCacheKey& other) const
+	{
+		return device == other.device && inode == other.inode;
+	}
+};
+
+// Combines the device and the inode into a table hash
+struct DigestCacheKeyHash
+{
+	size_t operator()(const DigestCacheKey& key) const
+	{
+		return std::hash<unsigned long long>()(key.inode * 0x9e3779b97f4a7c15ULL ^ key.device);
+	}
+};
+
+// The version of a file whose digest is cached
+struct DigestCacheEntry
+{
+	unsigned long long size;
+	unsigned long long modifiedNanoseconds;
+	Digest digest;
+};
+
+// The cached digests and the log file they are kept in
+// The log only grows by whole records, so concurrent processes and crashes can't corrupt the older records
+struct DigestCache
+{
+	std::string path;
+	std::unordered_map<DigestCacheKey, DigestCacheEntry, DigestCacheKeyHash> entries;
+	std::FILE* log;
+	std::mutex mutex;
+};
+
+bool openDigestCache(const char* path, DigestCache& cache);
+void closeDigestCache(DigestCache& cache);
+CachedHashSource hashFileCached(DigestCache& cache, const char* path, bool isVerifying, FileDigestFunction hashFunction, Digest& digest);
\ No newline at end of file
@@ -0,0 +1,655 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the hashing of files straight from the operating system
+* Regular files are memory-mapped one window at a time, other files are read in large aligned chunks
+* Either way the memory used doesn't depend on the file size
+* A file that shrinks while it is mapped makes the missing pages fault, which is caught and reported as a failed read
+*
+*/
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <csetjmp>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "FileHashing.h"
+#include "Metrics.h"
+#include "ReadPipeline.h"
+#include "SHA256.h"
+
+// The mapped part of a file at any moment, a multiple of the mapping granularity of every platform
+const unsigned long long MAPPING_WINDOW_BYTES = 16ULL << 20;
+
+// The smallest page size of every platform, the stride that touches each page of a mapped window
+const size_t MAPPED_PAGE_BYTES = 4096;
+
+// The alignment of the offsets, sizes and buffers of direct reads
+const size_t DIRECT_IO_ALIGNMENT = PIPELINE_BUFFER_ALIGNMENT;
+
+// How hashing a file through memory mapping ended
+enum MappedHashResult
+{
+	MAPPED_HASHED,
+	MAPPED_UNAVAILABLE,
+	MAPPED_UNREADABLE
+};
+
+// Returns the smaller of two sizes
+unsigned long long getMinSize(unsigned long long first, unsigned long long second)
+{
+	return first > second ? second : first;
+}
+
+// Touches every page of a mapped window under the read timer, so the page-in is counted as reading and not as compressing
+// Only done with the metrics enabled, as hashing the window faults its pages in anyway
+void touchMappedWindow(const void* window, size_t windowBytes)
+{
+	if (!METRICS_IS_ENABLED())
+	{
+		return;
+	}
+
+	METRICS_START(readStart);
+	const volatile unsigned char* bytes = static_cast<const volatile unsigned char*>(window);
+	for (size_t i = 0; i < windowBytes; i += MAPPED_PAGE_BYTES)
+	{
+		bytes[i];
+	}
+	METRICS_STOP(STAGE_READ, readStart);
+}
+
+#ifdef _WIN32
+
+// Opens a file for reading at any offset and finds its size
+// Returns false if the file can't be opened
+bool openReadableFile(const char* path, ReadableFile& file)
+{
+	HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(handle, &fileSize))
+	{
+		CloseHandle(handle);
+		return false;
+	}
+
+	file.handle = handle;
+	file.size = (unsigned long long)fileSize.QuadPart;
+	return true;
+}
+
+// Reads up to the given amount of bytes from an offset of the file
+// Returns the count of read bytes or -1 if the reading fails
+long long readFileAt(const ReadableFile& file, unsigned long long offset, void* buffer, size_t size)
+{
+	OVERLAPPED position = {};
+	position.Offset = (DWORD)offset;
+	position.OffsetHigh = (DWORD)(offset >> 32);
+
+	DWORD bytesRead = 0;
+	if (!ReadFile((HANDLE)file.handle, buffer, (DWORD)size, &bytesRead, &position) && GetLastError() != ERROR_HANDLE_EOF)
+	{
+		return -1;
+	}
+
+	return bytesRead;
+}
+
+// Closes a file opened for reading at any offset
+void closeReadableFile(ReadableFile& file)
+{
+	CloseHandle((HANDLE)file.handle);
+	file.handle = nullptr;
+}
+
+// Finds the volume, file index, size and last write time of a file without opening it for reading
+// Returns false if the file can't be found
+bool getFileIdentity(const char* path, FileIdentity& identity)
+{
+	// The 100 nanosecond intervals between the Windows epoch in 1601 and the Unix epoch
+	const unsigned long long UNIX_EPOCH_INTERVALS = 116444736000000000ULL;
+	const unsigned long long NANOSECONDS_IN_INTERVAL = 100;
+
+	HANDLE handle = CreateFileA(path, 0, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	BY_HANDLE_FILE_INFORMATION information;
+	bool success = GetFileInformationByHandle(handle, &information) != 0;
+	CloseHandle(handle);
+
+	if (!success)
+	{
+		return false;
+	}
+
+	unsigned long long writeTime = ((unsigned long long)information.ftLastWriteTime.dwHighDateTime << 32) | information.ftLastWriteTime.dwLowDateTime;
+
+	identity.device = information.dwVolumeSerialNumber;
+	identity.inode = ((unsigned long long)information.nFileIndexHigh << 32) | information.nFileIndexLow;
+	identity.size = ((unsigned long long)information.nFileSizeHigh << 32) | information.nFileSizeLow;
+	identity.modifiedNanoseconds = (writeTime - UNIX_EPOCH_INTERVALS) * NANOSECONDS_IN_INTERVAL;
+	return true;
+}
+
+// Replaces a file with another in a single step
+bool replaceFile(const char* source, const char* destination)
+{
+	return MoveFileExA(source, destination, MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+// Hashes a mapped window of a file
+// Returns false if a page of the window can't be read, as when the file is on a volume that went away
+bool hashMappedWindow(const void* window, size_t windowBytes, ContextUpdater updater, void* context)
+{
+	__try
+	{
+		touchMappedWindow(window, windowBytes);
+		updater(context, window, windowBytes);
+	}
+	__except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+// Hashes up to the given amount of bytes of a regular file by mapping consecutive windows of it
+// Tells whether the file was hashed, can't be mapped and has to be read instead, or couldn't be read while mapped
+// Nothing is fed to the context before it is known that the file can be mapped
+MappedHashResult hashMappedFile(HANDLE file, unsigned long long maxBytes, ContextUpdater updater, void* context)
+{
+	LARGE_INTEGER fileSize;
+	if (GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		return MAPPED_UNAVAILABLE;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr)
+	{
+		return MAPPED_UNAVAILABLE;
+	}
+
+	unsigned long long bytesToHash = getMinSize((unsigned long long)fileSize.QuadPart, maxBytes);
+	for (unsigned long long offset = 0; offset < bytesToHash; offset += MAPPING_WINDOW_BYTES)
+	{
+		size_t windowBytes = (size_t)getMinSize(bytesToHash - offset, MAPPING_WINDOW_BYTES);
+		const void* window = MapViewOfFile(mapping, FILE_MAP_READ, (DWORD)(offset >> 32), (DWORD)offset, windowBytes);
+		if (window == nullptr)
+		{
+			CloseHandle(mapping);
+			return offset == 0 ? MAPPED_UNAVAILABLE : MAPPED_UNREADABLE;
+		}
+
+		METRICS_COUNT(COUNTER_BYTES_READ, windowBytes);
+		bool isHashed = hashMappedWindow(window, windowBytes, updater, context);
+		UnmapViewOfFile(window);
+
+		if (!isHashed)
+		{
+			CloseHandle(mapping);
+			return MAPPED_UNREADABLE;
+		}
+	}
+
+	CloseHandle(mapping);
+	return MAPPED_HASHED;
+}
+
+// Reads the next bytes of a file handle
+// The end of a pipe is reported as a broken pipe, which is the end of the file and not a failure
+long long readNextBytes(void* source, void* buffer, size_t size)
+{
+	HANDLE file = *static_cast<HANDLE*>(source);
+
+	DWORD bytesRead = 0;
+	if (!ReadFile(file, buffer, (DWORD)size, &bytesRead, nullptr))
+	{
+		return GetLastError() == ERROR_BROKEN_PIPE ? 0 : -1;
+	}
+
+	return bytesRead;
+}
+
+// Hashes up to the given amount of bytes of any readable file, reading ahead on a separate thread
+bool hashReadFile(HANDLE file, unsigned long long maxBytes, size_t requestAlignment, ContextUpdater updater, void* context)
+{
+	return hashPipelined(readNextBytes, &file, maxBytes, requestAlignment, updater, context);
+}
+
+// Feeds up to the given amount of bytes of a file, or of the standard input if the path is "-", to a context
+// Returns false if the file can't be read
+bool feedFile(const char* path, unsigned long long maxBytes, ContextUpdater updater, void* context)
+{
+	if (strcmp(path, STANDARD_INPUT_PATH) == 0)
+	{
+		return hashReadFile(GetStdHandle(STD_INPUT_HANDLE), maxBytes, 1, updater, context);
+	}
+
+	HANDLE file = CreateFileA(
+		path,
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		nullptr,
+		OPEN_EXISTING,
+		FILE_FLAG_SEQUENTIAL_SCAN,
+		nullptr);
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	MappedHashResult mappedResult = hashMappedFile(file, maxBytes, updater, context);
+	bool success = mappedResult == MAPPED_HASHED;
+	if (mappedResult == MAPPED_UNAVAILABLE)
+	{
+		success = hashReadFile(file, maxBytes, 1, updater, context);
+	}
+
+	CloseHandle(file);
+	return success;
+}
+
+// Feeds up to the given amount of bytes of a file to a context with unbuffered reads that bypass the system cache
+// Falls back to buffered reads if the file can't be opened without buffering
+// Returns false if the file can't be read
+bool feedFileDirect(const char* path, unsigned long long maxBytes, ContextUpdater updater, void* context)
+{
+	if (strcmp(path, STANDARD_INPUT_PATH) == 0)
+	{
+		return hashReadFile(GetStdHandle(STD_INPUT_HANDLE), maxBytes, 1, updater, context);
+	}
+
+	size_t requestAlignment = DIRECT_IO_ALIGNMENT;
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		requestAlignment = 1;
+		file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	}
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	bool success = hashReadFile(file, maxBytes, requestAlignment, updater, context);
+	CloseHandle(file);
+	return success;
+}
+
+#else
+
+// Opens a file for reading at any offset and finds its size
+// Returns false if the file can't be opened
+bool openReadableFile(const char* path, ReadableFile& file)
+{
+	int descriptor = open(path, O_RDONLY);
+	if (descriptor < 0)
+	{
+		return false;
+	}
+
+	struct stat fileInfo;
+	if (fstat(descriptor, &fileInfo) != 0)
+	{
+		close(descriptor);
+		return false;
+	}
+
+	file.descriptor = descriptor;
+	file.size = (unsigned long long)fileInfo.st_size;
+	return true;
+}
+
+// Reads up to the given amount of bytes from an offset of the file
+// Returns the count of read bytes or -1 if the reading fails
+long long readFileAt(const ReadableFile& file, unsigned long long offset, void* buffer, size_t size)
+{
+	size_t totalRead = 0;
+	while (totalRead < size)
+	{
+		ssize_t bytesRead = pread(file.descriptor, (unsigned char*)buffer + totalRead, size - totalRead, (off_t)(offset + totalRead));
+		if (bytesRead < 0)
+		{
+			return -1;
+		}
+
+		if (bytesRead == 0)
+		{
+			break;
+		}
+
+		totalRead += (size_t)bytesRead;
+	}
+
+	return (long long)totalRead;
+}
+
+// Closes a file opened for reading at any offset
+void closeReadableFile(ReadableFile& file)
+{
+	close(file.descriptor);
+	file.descriptor = -1;
+}
+
+// Finds the device, inode, size and last modification time of a file
+// Returns false if the file can't be found
+bool getFileIdentity(const char* path, FileIdentity& identity)
+{
+	const unsigned long long NANOSECONDS_IN_SECOND = 1000000000ULL;
+
+	struct stat fileInfo;
+	if (stat(path, &fileInfo) != 0)
+	{
+		return false;
+	}
+
+#ifdef __APPLE__
+	const struct timespec& modified = fileInfo.st_mtimespec;
+#else
+	const struct timespec& modified = fileInfo.st_mtim;
+#endif
+
+	identity.device = (unsigned long long)fileInfo.st_dev;
+	identity.inode = (unsigned long long)fileInfo.st_ino;
+	identity.size = (unsigned long long)fileInfo.st_size;
+	identity.modifiedNanoseconds = (unsigned long long)modified.tv_sec * NANOSECONDS_IN_SECOND + (unsigned long long)modified.tv_nsec;
+	return true;
+}
+
+// Replaces a file with another in a single step
+bool replaceFile(const char* source, const char* destination)
+{
+	return rename(source, destination) == 0;
+}
+
+// Where a thread that is hashing a mapped window jumps when a page of the window can't be read
+thread_local sigjmp_buf* mappedFaultJump = nullptr;
+
+// Leaves the mapped window whose page couldn't be read
+// A bus error anywhere else is a real fault, so the default action is restored and the signal is raised again
+void handleMappedFault(int signalNumber)
+{
+	sigjmp_buf* faultJump = mappedFaultJump;
+	if (faultJump != nullptr)
+	{
+		siglongjmp(*faultJump, 1);
+	}
+
+	signal(signalNumber, SIG_DFL);
+	raise(signalNumber);
+}
+
+// Installs the handler of the bus errors raised by pages past the end of a shrunk mapped file
+// Returns whether the handler is installed
+bool installMappedFaultHandler()
+{
+	struct sigaction action = {};
+	action.sa_handler = handleMappedFault;
+	sigemptyset(&action.sa_mask);
+
+	return sigaction(SIGBUS, &action, nullptr) == 0;
+}
+
+// Hashes a mapped window of a file
+// Returns false if a page of the window can't be read, which happens when the file shrinks while it is mapped
+bool hashMappedWindow(const void* window, size_t windowBytes, ContextUpdater updater, void* context)
+{
+	static const bool IS_HANDLER_INSTALLED = installMappedFaultHandler();
+	if (!IS_HANDLER_INSTALLED)
+	{
+		touchMappedWindow(window, windowBytes);
+		updater(context, window, windowBytes);
+		return true;
+	}
+
+	sigjmp_buf faultJump;
+	if (sigsetjmp(faultJump, 1) != 0)
+	{
+		mappedFaultJump = nullptr;
+		return false;
+	}
+
+	mappedFaultJump = &faultJump;
+	touchMappedWindow(window, windowBytes);
+	updater(context, window, windowBytes);
+	mappedFaultJump = nullptr;
+	return true;
+}
+
+// Hashes up to the given amount of bytes of a regular file by mapping consecutive windows of it
+// Tells whether the file was hashed, can't be mapped and has to be read instead, or couldn't be read while mapped
+// Nothing is fed to the context before it is known that the file can be mapped
+MappedHashResult hashMappedFile(int file, unsigned long long maxBytes, ContextUpdater updater, void* context)
+{
+	struct stat fileInfo;
+	if (fstat(file, &fileInfo) != 0 || !S_ISREG(fileInfo.st_mode) || fileInfo.st_size == 0)
+	{
+		return MAPPED_UNAVAILABLE;
+	}
+
+	unsigned long long bytesToHash = getMinSize((unsigned long long)fileInfo.st_size, maxBytes);
+	for (unsigned long long offset = 0; offset < bytesToHash; offset += MAPPING_WINDOW_BYTES)
+	{
+		size_t windowBytes = (size_t)getMinSize(bytesToHash - offset, MAPPING_WINDOW_BYTES);
+		void* window = mmap(nullptr, windowBytes, PROT_READ, MAP_PRIVATE, file, (off_t)offset);
+		if (window == MAP_FAILED)
+		{
+			return offset == 0 ? MAPPED_UNAVAILABLE : MAPPED_UNREADABLE;
+		}
+
+		madvise(window, windowBytes, MADV_SEQUENTIAL);
+		METRICS_COUNT(COUNTER_BYTES_READ, windowBytes);
+		bool isHashed = hashMappedWindow(window, windowBytes, updater, context);
+		munmap(window, windowBytes);
+
+		if (!isHashed)
+		{
+			return MAPPED_UNREADABLE;
+		}
+	}
+
+	return MAPPED_HASHED;
+}
+
+// Reads the next bytes of a file descriptor
+long long readNextBytes(void* source, void* buffer, size_t size)
+{
+	int file = *static_cast<int*>(source);
+
+	ssize_t bytesRead = read(file, buffer, size);
+	while (bytesRead < 0 && errno == EINTR)
+	{
+		bytesRead = read(file, buffer, size);
+	}
+
+	return bytesRead;
+}
+
+#ifdef O_DIRECT
+
+// Reads the next bytes of a file descriptor opened with O_DIRECT
+// Some file systems accept O_DIRECT when opening but refuse the reads with EINVAL, then the descriptor
+// is switched to cached reads and the read is made again from the same offset
+long long readNextDirectBytes(void* source, void* buffer, size_t size)
+{
+	int file = *static_cast<int*>(source);
+
+	long long bytesRead = readNextBytes(source, buffer, size);
+	if (bytesRead >= 0 || errno != EINVAL)
+	{
+		return bytesRead;
+	}
+
+	int flags = fcntl(file, F_GETFL);
+	if (flags < 0 || (flags & O_DIRECT) == 0 || fcntl(file, F_SETFL, flags & ~O_DIRECT) != 0)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	return readNextBytes(source, buffer, size);
+}
+
+#endif
+
+// Hashes up to the given amount of bytes of any readable file, reading ahead on a separate thread
+// This covers pipes, character devices and other files that can't be mapped
+bool hashReadFile(int file, unsigned long long maxBytes, size_t requestAlignment, ContextUpdater updater, void* context)
+{
+	return hashPipelined(readNextBytes, &file, maxBytes, requestAlignment, updater, context);
+}
+
+// Feeds up to the given amount of bytes of a file, or of the standard input if the path is "-", to a context
+// The standard input is always read and never mapped, since it may be a file that was already partly read
+// Returns false if the file can't be read
+bool feedFile(const char* path, unsigned long long maxBytes, ContextUpdater updater, void* context)
+{
+	if (strcmp(path, STANDARD_INPUT_PATH) == 0)
+	{
+		return hashReadFile(STDIN_FILENO, maxBytes, 1, updater, context);
+	}
+
+	int file = open(path, O_RDONLY);
+	if (file < 0)
+	{
+		return false;
+	}
+
+	MappedHashResult mappedResult = hashMappedFile(file, maxBytes, updater, context);
+	bool success = mappedResult == MAPPED_HASHED;
+	if (mappedResult == MAPPED_UNAVAILABLE)
+	{
+		success = hashReadFile(file, maxBytes, 1, updater, context);
+	}
+
+	close(file);
+	return success;
+}
+
+// Feeds up to the given amount of bytes of a file to a context with direct reads that bypass the page cache where supported
+// Falls back to cached reads if the file system doesn't support direct I/O, when opening or when reading
+// Returns false if the file can't be read
+bool feedFileDirect(const char* path, unsigned long long maxBytes, ContextUpdater updater, void* context)
+{
+	if (strcmp(path, STANDARD_INPUT_PATH) == 0)
+	{
+		return hashReadFile(STDIN_FILENO, maxBytes, 1, updater, context);
+	}
+
+	size_t requestAlignment = 1;
+	SequentialReader reader = readNextBytes;
+	int file = -1;
+
+#ifdef O_DIRECT
+	file = open(path, O_RDONLY | O_DIRECT);
+	requestAlignment = DIRECT_IO_ALIGNMENT;
+	reader = readNextDirectBytes;
+#endif
+
+	if (file < 0)
+	{
+		requestAlignment = 1;
+		reader = readNextBytes;
+		file = open(path, O_RDONLY);
+	}
+
+	if (file < 0)
+	{
+		return false;
+	}
+
+#ifdef __APPLE__
+	fcntl(file, F_NOCACHE, 1);
+#endif
+
+	bool success = hashPipelined(reader, &file, maxBytes, requestAlignment, updater, context);
+	close(file);
+	return success;
+}
+
+#endif
+
+// Feeds message bytes to a SHA256 context
+void updateSha256Context(void* context, const void* data, size_t size)
+{
+	updateContext(*static_cast<Sha256Context*>(context), data, size);
+}
+
+// Hashes up to the given amount of bytes of a file into a caller-provided digest, reading it with the given function
+// Returns false if the file can't be read
+bool hashFileDigestWith(FileFeedFunction feedFunction, const char* path, unsigned long long maxBytes, Digest& digest)
+{
+	METRICS_FILE_START(fileStart);
+
+	Sha256Context context;
+	initContext(context);
+
+	if (!feedFunction(path, maxBytes, updateSha256Context, &context))
+	{
+		return false;
+	}
+
+	finalContextDigest(context, digest);
+	METRICS_FILE_STOP(fileStart);
+	return true;
+}
+
+// Hashes up to the given amount of bytes of a file into a caller-provided digest
+// Returns false if the file can't be read
+bool hashFileDigest(const char* path, unsigned long long maxBytes, Digest& digest)
+{
+	return hashFileDigestWith(feedFile, path, maxBytes, digest);
+}
+
+// Hashes up to the given amount of bytes of a file into a caller-provided digest with direct reads
+// Returns false if the file can't be read
+bool hashFileDirectDigest(const char* path, unsigned long long maxBytes, Digest& digest)
+{
+	return hashFileDigestWith(feedFileDirect, path, maxBytes, digest);
+}
+
+// Hashes up to the given amount of bytes of a file
+// Returns a string of the hash result or a null pointer if the file can't be read
+char* hashFile(const char* path, unsigned long long maxBytes)
+{
+	Digest digest;
+	if (!hashFileDigest(path, maxBytes, digest))
+	{
+		return nullptr;
+	}
+
+	return getDigestText(digest);
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the declarations of the file hashing and file reading functions that can be included by other files
+*
+*/
+
+#pragma once
+
+#include <cstddef>
+
+#include "ReadPipeline.h"
+#include "SHA256.h"
+
+// The path that stands for the standard input, as in sha256sum
+const char STANDARD_INPUT_PATH[] = "-";
+
+// A file opened for reading at any offset
+struct ReadableFile
+{
+#ifdef _WIN32
+	void* handle;
+#else
+	int descriptor;
+#endif
+	unsigned long long size;
+};
+
+// What identifies a version of a file - the device, the file on it, its size and its last modification time
+// The modification time is in nanoseconds since the Unix epoch
+struct FileIdentity
+{
+	unsigned long long device;
+	unsigned long long inode;
+	unsigned long long size;
+	unsigned long long modifiedNanoseconds;
+};
+
+// A function that hashes up to the given amount of bytes of a file and returns false if it can't be read
+typedef bool (*FileDigestFunction)(const char* path, unsigned long long maxBytes, Digest& digest);
+
+// A function that feeds up to the given amount of bytes of a file to the context of any hash function
+// Returns false if the file can't be read
+typedef bool (*FileFeedFunction)(const char* path, unsigned long long maxBytes, ContextUpdater updater, void* context);
+
+bool openReadableFile(const char* path, ReadableFile& file);
+long long readFileAt(const ReadableFile& file, unsigned long long offset, void* buffer, size_t size);
+void closeReadableFile(ReadableFile& file);
+
+bool getFileIdentity(const char* path, FileIdentity& identity);
+bool replaceFile(const char* source, const char* destination);
+
+bool feedFile(const char* path, unsigned long long maxBytes, ContextUpdater updater, void* context);
+bool feedFileDirect(const char* path, unsigned long long maxBytes, ContextUpdater updater, void* context);
+
+bool hashFileDigest(const char* path, unsigned long long maxBytes, Digest& digest);
+bool hashFileDirectDigest(const char* path, unsigned long long maxBytes, Digest& digest);
+char* hashFile(const char* path, unsigned long long maxBytes);
\ No newline at end of file
@@ -15,4 +15,6 @@
 
 #pragma once
 
+#include <cstddef>
+
 size_t getLength(const char* text);
\ No newline at end of file
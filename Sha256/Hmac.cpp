@@ -0,0 +1,189 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains HMAC-SHA256 (RFC 2104) and HKDF-SHA256 (RFC 5869)
+* The padded key blocks are hashed once per key, so each message costs two compressions less than plain HMAC
+*
+*/
+
+#include "Hmac.h"
+
+typedef unsigned char byte;
+
+const size_t HMAC_BLOCK_BYTES = CONTEXT_BLOCK_BYTES;
+const byte INNER_PAD = 0x36;
+const byte OUTER_PAD = 0x5c;
+
+// How many inner digests hmacMany keeps on the stack before hashing them with the outer key
+const size_t HMAC_BATCH_SIZE = 64;
+
+// Creates a context that has hashed a key block XORed with a pad byte
+void initPaddedKeyPrefix(Sha256Context& prefix, const byte* keyBlock, byte pad)
+{
+	byte paddedKey[HMAC_BLOCK_BYTES];
+	for (size_t i = 0; i < HMAC_BLOCK_BYTES; i++)
+	{
+		paddedKey[i] = keyBlock[i] ^ pad;
+	}
+
+	initContext(prefix);
+	updateContext(prefix, paddedKey, HMAC_BLOCK_BYTES);
+}
+
+// Prepares the inner and outer midstates of a key
+// Keys longer than a block are hashed first, shorter keys are padded with zeros
+void initHmacKey(HmacKey& key, const void* keyBytes, size_t keySize)
+{
+	byte keyBlock[HMAC_BLOCK_BYTES] = { 0 };
+
+	if (keySize > HMAC_BLOCK_BYTES)
+	{
+		Digest keyDigest;
+		hashBytesDigest(static_cast<const byte*>(keyBytes), keySize, keyDigest);
+		for (size_t i = 0; i < DIGEST_BYTES; i++)
+		{
+			keyBlock[i] = keyDigest.bytes[i];
+		}
+	}
+	else
+	{
+		const byte* bytes = static_cast<const byte*>(keyBytes);
+		for (size_t i = 0; i < keySize; i++)
+		{
+			keyBlock[i] = bytes[i];
+		}
+	}
+
+	initPaddedKeyPrefix(key.innerPrefix, keyBlock, INNER_PAD);
+	initPaddedKeyPrefix(key.outerPrefix, keyBlock, OUTER_PAD);
+}
+
+// Initializes a context for a new incremental HMAC operation with a prepared key
+// The key must stay alive until the context is finished
+void initHmacContext(HmacContext& context, const HmacKey& key)
+{
+	context.inner = key.innerPrefix;
+	context.key = &key;
+}
+
+// Feeds more message bytes to an incremental HMAC operation
+void updateHmacContext(HmacContext& context, const void* data, size_t size)
+{
+	updateContext(context.inner, data, size);
+}
+
+// Finishes an incremental HMAC operation and writes the raw bytes of the result
+void finalHmacContext(HmacContext& context, Digest& digest)
+{
+	Digest innerDigest;
+	finalContextDigest(context.inner, innerDigest);
+
+	hashSuffixDigest(context.key->outerPrefix, innerDigest.bytes, DIGEST_BYTES, digest);
+}
+
+// Calculates the HMAC of a message with a prepared key
+void hmacDigest(const HmacKey& key, const void* data, size_t size, Digest& digest)
+{
+	Digest innerDigest;
+	hashSuffixDigest(key.innerPrefix, data, size, innerDigest);
+
+	hashSuffixDigest(key.outerPrefix, innerDigest.bytes, DIGEST_BYTES, digest);
+}
+
+// Calculates the HMACs of a batch of messages with the same prepared key and writes them in the same order
+// Both the inner and the outer hashes go through the multi-buffer lanes
+void hmacMany(const HmacKey& key, const MessageSpan* inputs, size_t count, Digest* results)
+{
+	if (inputs == nullptr || results == nullptr)
+	{
+		return;
+	}
+
+	Digest innerDigests[HMAC_BATCH_SIZE];
+	MessageSpan innerSpans[HMAC_BATCH_SIZE];
+
+	for (size_t start = 0; start < count; start += HMAC_BATCH_SIZE)
+	{
+		size_t batchSize = count - start < HMAC_BATCH_SIZE ? count - start : HMAC_BATCH_SIZE;
+
+		hashManySuffixes(key.innerPrefix, inputs + start, batchSize, innerDigests);
+
+		for (size_t i = 0; i < batchSize; i++)
+		{
+			innerSpans[i].data = innerDigests[i].bytes;
+			innerSpans[i].size = DIGEST_BYTES;
+		}
+
+		hashManySuffixes(key.outerPrefix, innerSpans, batchSize, results + start);
+	}
+}
+
+// Concentrates the entropy of an input key into a pseudorandom key
+// An empty salt is the same as a salt of DIGEST_BYTES zeros
+void hkdfExtract(const void* salt, size_t saltSize, const void* inputKey, size_t inputKeySize, Digest& pseudorandomKey)
+{
+	HmacKey saltKey;
+	initHmacKey(saltKey, salt, saltSize);
+
+	hmacDigest(saltKey, inputKey, inputKeySize, pseudorandomKey);
+}
+
+// Expands a pseudorandom key into the given amount of output bytes bound to the info
+// Returns false if more than HKDF_MAX_OUTPUT_BYTES are requested
+bool hkdfExpand(const Digest& pseudorandomKey, const void* info, size_t infoSize, unsigned char* output, size_t outputSize)
+{
+	if (outputSize > HKDF_MAX_OUTPUT_BYTES || (output == nullptr && outputSize > 0))
+	{
+		return false;
+	}
+
+	HmacKey key;
+	initHmacKey(key, pseudorandomKey.bytes, DIGEST_BYTES);
+
+	Digest block;
+	byte counter = 1;
+	for (size_t written = 0; written < outputSize; written += DIGEST_BYTES)
+	{
+		HmacContext context;
+		initHmacContext(context, key);
+		if (counter > 1)
+		{
+			updateHmacContext(context, block.bytes, DIGEST_BYTES);
+		}
+		updateHmacContext(context, info, infoSize);
+		updateHmacContext(context, &counter, 1);
+		finalHmacContext(context, block);
+
+		size_t blockBytes = outputSize - written < DIGEST_BYTES ? outputSize - written : DIGEST_BYTES;
+		for (size_t i = 0; i < blockBytes; i++)
+		{
+			output[written + i] = block.bytes[i];
+		}
+
+		counter++;
+	}
+
+	return true;
+}
+
+// Derives the given amount of output bytes from an input key with an extract and an expand step
+// Returns false if more than HKDF_MAX_OUTPUT_BYTES are requested
+bool hkdf(
+	const void* salt, size_t saltSize,
+	const void* inputKey, size_t inputKeySize,
+	const void* info, size_t infoSize,
+	unsigned char* output, size_t outputSize)
+{
+	Digest pseudorandomKey;
+	hkdfExtract(salt, saltSize, inputKey, inputKeySize, pseudorandomKey);
+
+	return hkdfExpand(pseudorandomKey, info, infoSize, output, outputSize);
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the declarations of HMAC-SHA256 (RFC 2104) and HKDF-SHA256 (RFC 5869)
+*
+*/
+
+#pragma once
+
+#include <cstddef>
+
+#include "SHA256.h"
+
+const size_t HKDF_MAX_OUTPUT_BYTES = 255 * DIGEST_BYTES;
+
+// The inner and outer midstates of a key, hashed once and reused for every message signed with it
+struct HmacKey
+{
+	Sha256Context innerPrefix;
+	Sha256Context outerPrefix;
+};
+
+// The state of an incremental HMAC operation
+struct HmacContext
+{
+	Sha256Context inner;
+	const HmacKey* key;
+};
+
+void initHmacKey(HmacKey& key, const void* keyBytes, size_t keySize);
+
+void initHmacContext(HmacContext& context, const HmacKey& key);
+void updateHmacContext(HmacContext& context, const void* data, size_t size);
+void finalHmacContext(HmacContext& context, Digest& digest);
+
+void hmacDigest(const HmacKey& key, const void* data, size_t size, Digest& digest);
+void hmacMany(const HmacKey& key, const MessageSpan* inputs, size_t count, Digest* results);
+
+void hkdfExtract(const void* salt, size_t saltSize, const void* inputKey, size_t inputKeySize, Digest& pseudorandomKey);
+bool hkdfExpand(const Digest& pseudorandomKey, const void* info, size_t infoSize, unsigned char* output, size_t outputSize);
+bool hkdf(
+	const void* salt, size_t saltSize,
+	const void* inputKey, size_t inputKeySize,
+	const void* info, size_t infoSize,
+	unsigned char* output, size_t outputSize);
\ No newline at end of file
@@ -0,0 +1,249 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the checksum manifest reader
+* A manifest is read whole into one buffer and each line is split in place, so a manifest of hundreds of thousands
+* of files takes a few large reads and no allocation per line besides the entry list
+* It is read until its end rather than by its size, so it can come from a pipe or the standard input
+*
+*/
+
+#include <cstdio>
+#include <cstring>
+
+#include "FileHashing.h"
+#include "Manifest.h"
+
+using namespace std;
+
+const size_t HASH_FIELD_SIZE = 2 * DIGEST_BYTES;
+const size_t INITIAL_MANIFEST_BYTES = 64 << 10;
+
+// Starts an empty manifest
+void initManifest(Manifest& manifest)
+{
+	manifest.texts.clear();
+	manifest.entries.clear();
+	manifest.invalidLinesCount = 0;
+}
+
+// Checks whether a path has to be escaped in a manifest line - if it has a backslash or a line end
+bool isPathEscaped(const char* path)
+{
+	return strpbrk(path, "\\\n\r") != nullptr;
+}
+
+// Writes the escape sequences of a path that unescapePath decodes
+// A line with an escaped path has to start with a backslash
+string escapePath(const char* path)
+{
+	string escaped;
+	for (; *path != '\0'; path++)
+	{
+		if (*path == '\\')
+		{
+			escaped += "\\\\";
+		}
+		else if (*path == '\n')
+		{
+			escaped += "\\n";
+		}
+		else if (*path == '\r')
+		{
+			escaped += "\\r";
+		}
+		else
+		{
+			escaped += *path;
+		}
+	}
+
+	return escaped;
+}
+
+// Replaces the escape sequences of a path in place - "\\" with a backslash, "\n" with a new line and "\r" with a carriage return
+// sha256sum escapes the paths that contain any of these characters and starts their lines with a backslash
+// Returns false if the path has any other escape sequence
+bool unescapePath(char* path)
+{
+	char* output = path;
+	for (const char* input = path; *input != '\0'; input++)
+	{
+		if (*input != '\\')
+		{
+			*output++ = *input;
+			continue;
+		}
+
+		input++;
+		if (*input == '\\')
+		{
+			*output++ = '\\';
+		}
+		else if (*input == 'n')
+		{
+			*output++ = '\n';
+		}
+		else if (*input == 'r')
+		{
+			*output++ = '\r';
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	*output = '\0';
+	return true;
+}
+
+// Reads the hash and the path of one line that is already terminated in place
+// The hash is followed by a space and then by a space in text mode or a star in binary mode
+// Returns false if the line isn't in this format
+bool parseManifestLine(char* line, size_t size, ManifestEntry& entry)
+{
+	bool isEscaped = size > 0 && line[0] == '\\';
+	if (isEscaped)
+	{
+		line++;
+		size--;
+	}
+
+	if (size <= HASH_FIELD_SIZE + 2 || line[HASH_FIELD_SIZE] != ' ' || (line[HASH_FIELD_SIZE + 1] != ' ' && line[HASH_FIELD_SIZE + 1] != '*'))
+	{
+		return false;
+	}
+
+	if (!parseDigest(line, HASH_FIELD_SIZE, entry.digest))
+	{
+		return false;
+	}
+
+	char* path = line + HASH_FIELD_SIZE + 2;
+	if (isEscaped && !unescapePath(path))
+	{
+		return false;
+	}
+
+	entry.path = path;
+	return true;
+}
+
+// Splits the text of a manifest into lines and adds an entry for each valid line
+// The line ends are overwritten with null characters, so the text must have one extra byte after its end
+void scanManifestText(Manifest& manifest, char* text, size_t size)
+{
+	char* end = text + size;
+	char* line = text;
+	while (line < end)
+	{
+		char* lineEnd = (char*)memchr(line, '\n', end - line);
+		if (lineEnd == nullptr)
+		{
+			lineEnd = end;
+		}
+
+		char* next = lineEnd + 1;
+		if (lineEnd > line && lineEnd[-1] == '\r')
+		{
+			lineEnd--;
+		}
+		*lineEnd = '\0';
+
+		if (lineEnd > line)
+		{
+			ManifestEntry entry;
+			if (parseManifestLine(line, lineEnd - line, entry))
+			{
+				manifest.entries.push_back(entry);
+			}
+			else
+			{
+				manifest.invalidLinesCount++;
+			}
+		}
+
+		line = next;
+	}
+}
+
+// Reads a stream until its end into a buffer that doubles whenever it fills up
+// The buffer keeps one extra byte after the read bytes for scanManifestText
+// Returns a null pointer if the stream can't be read
+char* readManifestStream(FILE* stream, size_t& size)
+{
+	size_t capacity = INITIAL_MANIFEST_BYTES;
+	char* text = new char[capacity + 1];
+
+	size = 0;
+	while (true)
+	{
+		size += fread(text + size, 1, capacity - size, stream);
+		if (size < capacity)
+		{
+			break;
+		}
+
+		char* grown = new char[2 * capacity + 1];
+		memcpy(grown, text, size);
+		delete[] text;
+		text = grown;
+		capacity *= 2;
+	}
+
+	if (ferror(stream))
+	{
+		delete[] text;
+		return nullptr;
+	}
+
+	return text;
+}
+
+// Reads a manifest file, or the standard input if the path is "-", and adds its entries
+// Returns false if the file can't be read
+bool addManifestFile(Manifest& manifest, const char* path)
+{
+	bool isStandardInput = strcmp(path, STANDARD_INPUT_PATH) == 0;
+	FILE* stream = isStandardInput ? stdin : fopen(path, "rb");
+	if (stream == nullptr)
+	{
+		return false;
+	}
+
+	size_t size = 0;
+	char* text = readManifestStream(stream, size);
+	if (!isStandardInput)
+	{
+		fclose(stream);
+	}
+
+	if (text == nullptr)
+	{
+		return false;
+	}
+
+	manifest.texts.push_back(text);
+	scanManifestText(manifest, text, size);
+	return true;
+}
+
+// Frees the texts of the manifests, after which the paths of the entries can't be used
+void freeManifest(Manifest& manifest)
+{
+	for (char* text : manifest.texts)
+	{
+		delete[] text;
+	}
+
+	initManifest(manifest);
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the declarations of the checksum manifest reader
+* A manifest has a "hash  path" line for each file, as printed by sha256sum and the batch mode
+*
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "SHA256.h"
+
+// A file listed in a manifest and the hash it should have
+// The path points into the text of the manifest
+struct ManifestEntry
+{
+	const char* path;
+	Digest digest;
+};
+
+// The entries of one or more manifests
+// The texts of the manifests are kept whole and their lines are split in place, so no path is copied
+struct Manifest
+{
+	std::vector<char*> texts;
+	std::vector<ManifestEntry> entries;
+	size_t invalidLinesCount;
+};
+
+bool isPathEscaped(const char* path);
+std::string escapePath(const char* path);
+bool unescapePath(char* path);
+
+void initManifest(Manifest& manifest);
+bool addManifestFile(Manifest& manifest, const char* path);
+void freeManifest(Manifest& manifest);
\ No newline at end of file
@@ -0,0 +1,636 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the append-only Merkle log of RFC 6962
+* An append hashes the new leaf with the frontier subtrees it completes, which is O(log n) nodes and one on average
+* The node file has every perfect subtree root in post-order, so the nodes of an append are written at its end,
+* and a node is found from its level and index without an index of the file
+* A proof needs a subtree hash of every range it covers, which is at most O(log n) stored nodes
+*
+*/
+
+#include <cstring>
+
+#include "FileHashing.h"
+#include "MerkleLog.h"
+#include "Sha256Constexpr.h"
+#include "TreeHashing.h"
+
+using namespace std;
+
+const char MERKLE_FRONTIER_MAGIC[8] = { 'S', 'H', 'A', 'M', 'R', 'K', 'L', '1' };
+const char* NEW_FRONTIER_SUFFIX = ".new";
+const size_t APPENDED_LEAVES_PER_BATCH = 64;
+
+// The start of a saved frontier, which is followed by a digest for every set bit of the size from the lowest,
+// then by the hash of everything before it
+struct MerkleFrontierHeader
+{
+	char magic[sizeof(MERKLE_FRONTIER_MAGIC)];
+	unsigned long long size;
+};
+
+// Counts the set bits of a number
+unsigned int countSetBits(unsigned long long number)
+{
+	unsigned int count = 0;
+	for (; number != 0; number &= number - 1)
+	{
+		count++;
+	}
+
+	return count;
+}
+
+// Counts the zero bits below the lowest set bit of a number that isn't zero
+unsigned int countTrailingZeros(unsigned long long number)
+{
+	unsigned int count = 0;
+	for (; (number & 1) == 0; number >>= 1)
+	{
+		count++;
+	}
+
+	return count;
+}
+
+// Finds the largest power of two that is less than a number greater than one
+unsigned long long getSplitSize(unsigned long long size)
+{
+	unsigned long long split = 1;
+	while (split < size - split)
+	{
+		split <<= 1;
+	}
+
+	return split;
+}
+
+// Counts the nodes of a tree of the given size in the node file
+// Every entry adds its leaf and a node for every subtree that it completes
+unsigned long long getMerkleNodesCount(unsigned long long size)
+{
+	return 2 * size - countSetBits(size);
+}
+
+// Finds where the root of a perfect subtree is in the node file
+// The subtree is written right after the leaf that completes it, along with the larger subtrees that leaf completes
+unsigned long long getMerkleNodePosition(unsigned int level, unsigned long long index)
+{
+	unsigned long long end = (index + 1) << level;
+	return getMerkleNodesCount(end) - 1 - (countTrailingZeros(end) - level);
+}
+
+// Moves to a node of the node file
+bool seekMerkleNode(FILE* nodes, unsigned long long position)
+{
+#ifdef _WIN32
+	return _fseeki64(nodes, (long long)(position * DIGEST_BYTES), SEEK_SET) == 0;
+#else
+	return fseeko(nodes, (off_t)(position * DIGEST_BYTES), SEEK_SET) == 0;
+#endif
+}
+
+// Reads the root of a perfect subtree, from the frontier if it is there or else from the node file
+// The subtree has to be within the log
+bool readMerkleNode(MerkleLog& log, unsigned int level, unsigned long long index, Digest& node)
+{
+	unsigned long long start = index << level;
+	unsigned long long frontierStart = (log.size >> level >> 1) << level << 1;
+	if ((log.size >> level & 1) != 0 && start == frontierStart)
+	{
+		node = log.frontier[level];
+		return true;
+	}
+
+	if (log.nodes == nullptr)
+	{
+		return false;
+	}
+
+	log.isNodesPositioned = false;
+	return seekMerkleNode(log.nodes, getMerkleNodePosition(level, index)) && fread(node.bytes, DIGEST_BYTES, 1, log.nodes) == 1;
+}
+
+// Hashes the entries from start to end as one subtree, from the roots of the perfect subtrees it splits into
+// The start has to be aligned like in the subtrees of the whole log, so the result is the RFC 6962 subtree hash
+bool hashMerkleRange(MerkleLog& log, unsigned long long start, unsigned long long end, Digest& hash)
+{
+	Digest parts[MERKLE_MAX_LEVELS];
+	size_t partsCount = 0;
+	while (start < end)
+	{
+		unsigned int level = 0;
+		while (level + 1 < MERKLE_MAX_LEVELS && (start & ((2ULL << level) - 1)) == 0 && (2ULL << level) <= end - start)
+		{
+			level++;
+		}
+
+		if (!readMerkleNode(log, level, start >> level, parts[partsCount]))
+		{
+			return false;
+		}
+
+		partsCount++;
+		start += 1ULL << level;
+	}
+
+	hash = parts[partsCount - 1];
+	for (size_t i = partsCount - 1; i > 0; i--)
+	{
+		hashTreeNode(parts[i - 1], hash, hash);
+	}
+
+	return true;
+}
+
+// Reverses the order of the digests of a proof, which are found from the root down but are listed from the leaf up
+void reverseProof(Digest* proof, size_t proofCount)
+{
+	for (size_t i = 0; i < proofCount / 2; i++)
+	{
+		Digest swapped = proof[i];
+		proof[i] = proof[proofCount - 1 - i];
+		proof[proofCount - 1 - i] = swapped;
+	}
+}
+
+// Starts an empty log that is only kept in memory
+void initMerkleLog(MerkleLog& log)
+{
+	log.size = 0;
+	log.frontierPath.clear();
+	log.nodes = nullptr;
+	log.isNodesPositioned = false;
+}
+
+// Reads a saved frontier into a log
+// Returns false if the file is damaged
+bool loadMerkleFrontier(FILE* file, MerkleLog& log)
+{
+	MerkleFrontierHeader header;
+	if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, MERKLE_FRONTIER_MAGIC, sizeof(header.magic)) != 0)
+	{
+		return false;
+	}
+
+	Sha256Context context;
+	initContext(context);
+	updateContext(context, &header, sizeof(header));
+
+	for (unsigned int level = 0; level < MERKLE_MAX_LEVELS; level++)
+	{
+		if ((header.size >> level & 1) == 0)
+		{
+			continue;
+		}
+
+		if (fread(log.frontier[level].bytes, DIGEST_BYTES, 1, file) != 1)
+		{
+			return false;
+		}
+		updateContext(context, log.frontier[level].bytes, DIGEST_BYTES);
+	}
+
+	Digest check;
+	Digest savedCheck;
+	finalContextDigest(context, check);
+	if (fread(savedCheck.bytes, DIGEST_BYTES, 1, file) != 1 || !areDigestsEqual(check, savedCheck))
+	{
+		return false;
+	}
+
+	log.size = header.size;
+	return true;
+}
+
+// Checks that the node file has every node of the log and that its subtree roots are the ones in the frontier
+bool checkMerkleNodes(MerkleLog& log)
+{
+	for (unsigned int level = 0; level < MERKLE_MAX_LEVELS; level++)
+	{
+		if ((log.size >> level & 1) == 0)
+		{
+			continue;
+		}
+
+		Digest stored;
+		unsigned long long index = log.size >> level >> 1 << 1;
+		if (!seekMerkleNode(log.nodes, getMerkleNodePosition(level, index)) || fread(stored.bytes, DIGEST_BYTES, 1, log.nodes) != 1 ||
+			!areDigestsEqual(stored, log.frontier[level]))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Opens a log from its saved frontier, or starts an empty one if there is none
+// The nodes are kept in the given file if there is a path for it, so proofs can be made
+// Nodes written after the frontier was last saved are written again by the next appends
+// Returns false if a file can't be opened or the frontier is damaged or doesn't match the nodes
+bool openMerkleLog(const char* frontierPath, const char* nodesPath, MerkleLog& log)
+{
+	initMerkleLog(log);
+	log.frontierPath = frontierPath;
+
+	FILE* file = fopen(frontierPath, "rb");
+	if (file != nullptr)
+	{
+		bool isLoaded = loadMerkleFrontier(file, log);
+		fclose(file);
+
+		if (!isLoaded)
+		{
+			return false;
+		}
+	}
+
+	if (nodesPath == nullptr)
+	{
+		return true;
+	}
+
+	log.nodes = fopen(nodesPath, "r+b");
+	if (log.nodes == nullptr && log.size == 0)
+	{
+		log.nodes = fopen(nodesPath, "w+b");
+	}
+
+	if (log.nodes != nullptr && !checkMerkleNodes(log))
+	{
+		fclose(log.nodes);
+		log.nodes = nullptr;
+	}
+
+	return log.nodes != nullptr;
+}
+
+// Writes the frontier to a new file, which then replaces the saved one
+// The node file is flushed first, so a saved frontier never has nodes that aren't written
+bool saveMerkleFrontier(MerkleLog& log)
+{
+	if (log.nodes != nullptr && fflush(log.nodes) != 0)
+	{
+		return false;
+	}
+
+	string newPath = log.frontierPath + NEW_FRONTIER_SUFFIX;
+	FILE* file = fopen(newPath.c_str(), "wb");
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	MerkleFrontierHeader header;
+	memcpy(header.magic, MERKLE_FRONTIER_MAGIC, sizeof(header.magic));
+	header.size = log.size;
+
+	Sha256Context context;
+	initContext(context);
+	updateContext(context, &header, sizeof(header));
+	bool success = fwrite(&header, sizeof(header), 1, file) == 1;
+
+	for (unsigned int level = 0; level < MERKLE_MAX_LEVELS; level++)
+	{
+		if ((log.size >> level & 1) != 0)
+		{
+			updateContext(context, log.frontier[level].bytes, DIGEST_BYTES);
+			success = fwrite(log.frontier[level].bytes, DIGEST_BYTES, 1, file) == 1 && success;
+		}
+	}
+
+	Digest check;
+	finalContextDigest(context, check);
+	success = fwrite(check.bytes, DIGEST_BYTES, 1, file) == 1 && success;
+
+	success = fclose(file) == 0 && success;
+	if (!success)
+	{
+		remove(newPath.c_str());
+		return false;
+	}
+
+	return replaceFile(newPath.c_str(), log.frontierPath.c_str());
+}
+
+// Saves the frontier of a log that has a path and closes its node file
+// Returns false if the frontier can't be saved
+bool closeMerkleLog(MerkleLog& log)
+{
+	bool success = log.frontierPath.empty() || saveMerkleFrontier(log);
+
+	if (log.nodes != nullptr)
+	{
+		success = fclose(log.nodes) == 0 && success;
+		log.nodes = nullptr;
+	}
+
+	return success;
+}
+
+// Appends an entry by its leaf hash and merges the frontier subtrees it completes
+// The log doesn't change if its nodes can't be written or it can't grow
+bool appendMerkleLeaf(MerkleLog& log, const Digest& leaf)
+{
+	if (log.size == ~0ULL)
+	{
+		return false;
+	}
+
+	Digest completed[MERKLE_MAX_LEVELS];
+	completed[0] = leaf;
+
+	unsigned int level = 0;
+	while ((log.size >> level & 1) != 0)
+	{
+		hashTreeNode(log.frontier[level], completed[level], completed[level + 1]);
+		level++;
+	}
+
+	if (log.nodes != nullptr)
+	{
+		bool isWritten = (log.isNodesPositioned || seekMerkleNode(log.nodes, getMerkleNodesCount(log.size))) &&
+			fwrite(completed, DIGEST_BYTES, level + 1, log.nodes) == level + 1;
+
+		log.isNodesPositioned = isWritten;
+		if (!isWritten)
+		{
+			return false;
+		}
+	}
+
+	log.frontier[level] = completed[level];
+	log.size++;
+	return true;
+}
+
+// Appends an entry by its bytes
+bool appendMerkleEntry(MerkleLog& log, const void* entry, size_t size)
+{
+	Digest leaf;
+	hashTreeLeaf(entry, size, leaf);
+
+	return appendMerkleLeaf(log, leaf);
+}
+
+// Appends entries in order, hashing their leaves in batches across the multi-buffer lanes
+// Returns false at the first entry that can't be appended, the ones before it stay in the log
+bool appendMerkleEntries(MerkleLog& log, const MessageSpan* entries, size_t count)
+{
+	Sha256Context leafPrefix;
+	initTreeLeafContext(leafPrefix);
+
+	Digest leaves[APPENDED_LEAVES_PER_BATCH];
+	for (size_t batchStart = 0; batchStart < count; batchStart += APPENDED_LEAVES_PER_BATCH)
+	{
+		size_t batchCount = count - batchStart < APPENDED_LEAVES_PER_BATCH ? count - batchStart : APPENDED_LEAVES_PER_BATCH;
+		hashManySuffixes(leafPrefix, entries + batchStart, batchCount, leaves);
+
+		for (size_t i = 0; i < batchCount; i++)
+		{
+			if (!appendMerkleLeaf(log, leaves[i]))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+// Finds the root of an empty tree, which is the hash of no bytes
+void hashEmptyTree(Digest& root)
+{
+	Sha256Context context;
+	initContext(context);
+	finalContextDigest(context, root);
+}
+
+// Finds the root of the whole log by folding its frontier from the smallest subtree up
+void getMerkleRoot(const MerkleLog& log, Digest& root)
+{
+	if (log.size == 0)
+	{
+		hashEmptyTree(root);
+		return;
+	}
+
+	unsigned int level = countTrailingZeros(log.size);
+	root = log.frontier[level];
+	for (level++; level < MERKLE_MAX_LEVELS; level++)
+	{
+		if ((log.size >> level & 1) != 0)
+		{
+			hashTreeNode(log.frontier[level], root, root);
+		}
+	}
+}
+
+// Finds the root the log had at an earlier size, which needs its nodes unless it is the current size
+bool getMerkleTreeRoot(MerkleLog& log, unsigned long long treeSize, Digest& root)
+{
+	if (treeSize == 0)
+	{
+		hashEmptyTree(root);
+		return true;
+	}
+
+	if (treeSize == log.size)
+	{
+		getMerkleRoot(log, root);
+		return true;
+	}
+
+	return treeSize < log.size && hashMerkleRange(log, 0, treeSize, root);
+}
+
+// Makes the audit path of an entry in the tree of the given size, from the sibling of its leaf up
+// The proof has at most MERKLE_MAX_INCLUSION_PROOF_DIGESTS digests
+bool getMerkleInclusionProof(MerkleLog& log, unsigned long long index, unsigned long long treeSize, Digest* proof, size_t& proofCount)
+{
+	proofCount = 0;
+	if (index >= treeSize || treeSize > log.size)
+	{
+		return false;
+	}
+
+	unsigned long long start = 0;
+	unsigned long long end = treeSize;
+	while (end - start > 1)
+	{
+		unsigned long long split = start + getSplitSize(end - start);
+		if (index < split)
+		{
+			if (!hashMerkleRange(log, split, end, proof[proofCount++]))
+			{
+				return false;
+			}
+			end = split;
+		}
+		else
+		{
+			if (!hashMerkleRange(log, start, split, proof[proofCount++]))
+			{
+				return false;
+			}
+			start = split;
+		}
+	}
+
+	reverseProof(proof, proofCount);
+	return true;
+}
+
+// Makes the proof that the tree of the new size extends the tree of the old size, from the smallest subtree up
+// The proof has at most MERKLE_MAX_CONSISTENCY_PROOF_DIGESTS digests
+bool getMerkleConsistencyProof(MerkleLog& log, unsigned long long oldSize, unsigned long long newSize, Digest* proof, size_t& proofCount)
+{
+	proofCount = 0;
+	if (oldSize == 0 || oldSize > newSize || newSize > log.size)
+	{
+		return false;
+	}
+
+	unsigned long long start = 0;
+	unsigned long long end = newSize;
+	bool isOldRoot = true;
+	while (oldSize != end)
+	{
+		unsigned long long split = start + getSplitSize(end - start);
+		if (oldSize <= split)
+		{
+			if (!hashMerkleRange(log, split, end, proof[proofCount++]))
+			{
+				return false;
+			}
+			end = split;
+		}
+		else
+		{
+			if (!hashMerkleRange(log, start, split, proof[proofCount++]))
+			{
+				return false;
+			}
+			start = split;
+			isOldRoot = false;
+		}
+	}
+
+	if (!isOldRoot && !hashMerkleRange(log, start, end, proof[proofCount++]))
+	{
+		return false;
+	}
+
+	reverseProof(proof, proofCount);
+	return true;
+}
+
+// Checks an audit path of a leaf against the root of a tree of the given size
+bool verifyMerkleInclusion(const Digest& leaf, unsigned long long index, unsigned long long treeSize,
+	const Digest* proof, size_t proofCount, const Digest& root)
+{
+	if (index >= treeSize)
+	{
+		return false;
+	}
+
+	unsigned long long node = index;
+	unsigned long long lastNode = treeSize - 1;
+	Digest hash = leaf;
+	for (size_t i = 0; i < proofCount; i++)
+	{
+		if (lastNode == 0)
+		{
+			return false;
+		}
+
+		if ((node & 1) != 0 || node == lastNode)
+		{
+			hashTreeNode(proof[i], hash, hash);
+			while ((node & 1) == 0 && node != 0)
+			{
+				node >>= 1;
+				lastNode >>= 1;
+			}
+		}
+		else
+		{
+			hashTreeNode(hash, proof[i], hash);
+		}
+
+		node >>= 1;
+		lastNode >>= 1;
+	}
+
+	return lastNode == 0 && areDigestsEqual(hash, root);
+}
+
+// Checks a proof that the tree with the new root extends the tree with the old root
+bool verifyMerkleConsistency(unsigned long long oldSize, unsigned long long newSize, const Digest& oldRoot, const Digest& newRoot,
+	const Digest* proof, size_t proofCount)
+{
+	if (oldSize == 0 || oldSize > newSize)
+	{
+		return false;
+	}
+
+	if (oldSize == newSize)
+	{
+		return proofCount == 0 && areDigestsEqual(oldRoot, newRoot);
+	}
+
+	// The old tree is a perfect subtree of the new one, so its root is the first digest and isn't in the proof
+	bool isOldPerfect = (oldSize & (oldSize - 1)) == 0;
+	if (proofCount == 0 && !isOldPerfect)
+	{
+		return false;
+	}
+
+	unsigned long long node = oldSize - 1;
+	unsigned long long lastNode = newSize - 1;
+	while ((node & 1) != 0)
+	{
+		node >>= 1;
+		lastNode >>= 1;
+	}
+
+	Digest oldHash = isOldPerfect ? oldRoot : proof[0];
+	Digest newHash = oldHash;
+	for (size_t i = isOldPerfect ? 0 : 1; i < proofCount; i++)
+	{
+		if (lastNode == 0)
+		{
+			return false;
+		}
+
+		if ((node & 1) != 0 || node == lastNode)
+		{
+			hashTreeNode(proof[i], oldHash, oldHash);
+			hashTreeNode(proof[i], newHash, newHash);
+			while ((node & 1) == 0 && node != 0)
+			{
+				node >>= 1;
+				lastNode >>= 1;
+			}
+		}
+		else
+		{
+			hashTreeNode(newHash, proof[i], newHash);
+		}
+
+		node >>= 1;
+		lastNode >>= 1;
+	}
+
+	return lastNode == 0 && areDigestsEqual(oldHash, oldRoot) && areDigestsEqual(newHash, newRoot);
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the declarations of the append-only Merkle log
+* Only the frontier of the RFC 6962 tree is kept in memory - the roots of its perfect subtrees, one per set bit of the size
+* The nodes can also be kept in a file, in post-order, which is what the inclusion and consistency proofs are read from
+*
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+#include "SHA256.h"
+
+const size_t MERKLE_MAX_LEVELS = 64;
+const size_t MERKLE_MAX_INCLUSION_PROOF_DIGESTS = MERKLE_MAX_LEVELS;
+const size_t MERKLE_MAX_CONSISTENCY_PROOF_DIGESTS = 2 * MERKLE_MAX_LEVELS;
+
+// An append-only Merkle tree of entries
+// frontier[level] is the root of the subtree of 2^level entries if that bit of the size is set
+// The frontier is saved to its path, and the nodes file is null if the log doesn't keep its nodes
+struct MerkleLog
+{
+	unsigned long long size;
+	Digest frontier[MERKLE_MAX_LEVELS];
+	std::string frontierPath;
+	FILE* nodes;
+	bool isNodesPositioned;
+};
+
+void initMerkleLog(MerkleLog& log);
+bool openMerkleLog(const char* frontierPath, const char* nodesPath, MerkleLog& log);
+bool saveMerkleFrontier(MerkleLog& log);
+bool closeMerkleLog(MerkleLog& log);
+
+bool appendMerkleLeaf(MerkleLog& log, const Digest& leaf);
+bool appendMerkleEntry(MerkleLog& log, const void* entry, size_t size);
+bool appendMerkleEntries(MerkleLog& log, const MessageSpan* entries, size_t count);
+void getMerkleRoot(const MerkleLog& log, Digest& root);
+
+bool getMerkleTreeRoot(MerkleLog& log, unsigned long long treeSize, Digest& root);
+bool getMerkleInclusionProof(MerkleLog& log, unsigned long long index, unsigned long long treeSize, Digest* proof, size_t& proofCount);
+bool getMerkleConsistencyProof(MerkleLog& log, unsigned long long oldSize, unsigned long long newSize, Digest* proof, size_t& proofCount);
+
+bool verifyMerkleInclusion(const Digest& leaf, unsigned long long index, unsigned long long treeSize,
+	const Digest* proof, size_t proofCount, const Digest& root);
+bool verifyMerkleConsistency(unsigned long long oldSize, unsigned long long newSize, const Digest& oldRoot, const Digest& newRoot,
+	const Digest* proof, size_t proofCount);
\ No newline at end of file
@@ -0,0 +1,301 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the hot path instrumentation and the writing of the collected metrics
+* as JSON or as the Prometheus text format
+*
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Metrics.h"
+
+using namespace std;
+
+#ifndef SHA256_NO_METRICS
+
+const char* COUNTER_NAMES[COUNTERS_COUNT] = { "bytes_read", "blocks_compressed", "messages_padded", "digests_formatted", "files_hashed" };
+const char* COUNTER_DESCRIPTIONS[COUNTERS_COUNT] =
+{
+	"Bytes read or mapped from files",
+	"Message blocks compressed through contexts and batches, counting each lane of a multi-buffer kernel",
+	"Messages whose final blocks were padded",
+	"Digests formatted as hexadecimal text",
+	"Whole files hashed"
+};
+const char* STAGE_NAMES[STAGES_COUNT] = { "read", "pad", "compress", "format" };
+const char* JSON_EXTENSION = ".json";
+const double NANOSECONDS_IN_SECOND = 1e9;
+const double SECONDS_IN_MICROSECOND = 1e-6;
+
+// The sums of the metrics of all threads at one moment
+struct MetricsSnapshot
+{
+	unsigned long long counts[COUNTERS_COUNT];
+	unsigned long long stageTicks[STAGES_COUNT];
+	unsigned long long latencyBuckets[LATENCY_BUCKETS_COUNT];
+	unsigned long long latencyNanoseconds;
+	double ticksPerSecond;
+};
+
+// The metrics of the running threads and the totals of the threads that have exited
+// The start clocks calibrate the stage ticks against the nanoseconds clock
+struct MetricsRegistry
+{
+	mutex threadsMutex;
+	vector<ThreadMetrics*> threads;
+	MetricsSnapshot exitedTotals;
+	unsigned long long startTicks;
+	unsigned long long startNanoseconds;
+};
+
+bool isMetricsEnabled = false;
+
+// Turns the instrumentation on, which has to be done before any thread starts hashing
+void enableMetrics()
+{
+	isMetricsEnabled = true;
+}
+
+// Reads the clock of the file latencies
+unsigned long long readMetricsNanoseconds()
+{
+	return (unsigned long long)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Returns the registry, which is created with the first thread metrics
+// It is never destroyed, so the threads that exit during the static destruction can still merge into it
+MetricsRegistry& getMetricsRegistry()
+{
+	static MetricsRegistry* registry = []()
+	{
+		MetricsRegistry* created = new MetricsRegistry();
+		created->exitedTotals = {};
+		created->startTicks = readMetricsTicks();
+		created->startNanoseconds = readMetricsNanoseconds();
+		return created;
+	}();
+
+	return *registry;
+}
+
+// Clears the metrics of a new thread and registers them
+ThreadMetrics::ThreadMetrics()
+{
+	for (atomic<unsigned long long>& count : counts)
+	{
+		count.store(0, memory_order_relaxed);
+	}
+	for (atomic<unsigned long long>& ticks : stageTicks)
+	{
+		ticks.store(0, memory_order_relaxed);
+	}
+	for (atomic<unsigned long long>& bucket : latencyBuckets)
+	{
+		bucket.store(0, memory_order_relaxed);
+	}
+	latencyNanoseconds.store(0, memory_order_relaxed);
+
+	MetricsRegistry& registry = getMetricsRegistry();
+	lock_guard<mutex> lock(registry.threadsMutex);
+	registry.threads.push_back(this);
+}
+
+// Adds the metrics of one thread to a snapshot
+void addThreadMetrics(const ThreadMetrics& metrics, MetricsSnapshot& snapshot)
+{
+	for (size_t i = 0; i < COUNTERS_COUNT; i++)
+	{
+		snapshot.counts[i] += metrics.counts[i].load(memory_order_relaxed);
+	}
+	for (size_t i = 0; i < STAGES_COUNT; i++)
+	{
+		snapshot.stageTicks[i] += metrics.stageTicks[i].load(memory_order_relaxed);
+	}
+	for (size_t i = 0; i < LATENCY_BUCKETS_COUNT; i++)
+	{
+		snapshot.latencyBuckets[i] += metrics.latencyBuckets[i].load(memory_order_relaxed);
+	}
+	snapshot.latencyNanoseconds += metrics.latencyNanoseconds.load(memory_order_relaxed);
+}
+
+// Merges the metrics of an exiting thread into the totals and unregisters them
+ThreadMetrics::~ThreadMetrics()
+{
+	MetricsRegistry& registry = getMetricsRegistry();
+	lock_guard<mutex> lock(registry.threadsMutex);
+
+	addThreadMetrics(*this, registry.exitedTotals);
+	registry.threads.erase(find(registry.threads.begin(), registry.threads.end(), this));
+}
+
+// Counts the latency of one hashed file in its power of two bucket
+void addFileLatency(unsigned long long nanoseconds)
+{
+	const unsigned long long NANOSECONDS_IN_MICROSECOND = 1000;
+
+	unsigned long long microseconds = nanoseconds / NANOSECONDS_IN_MICROSECOND;
+	size_t bucket = 0;
+	while (bucket < LATENCY_BUCKETS_COUNT - 1 && microseconds >= (1ULL << bucket))
+	{
+		bucket++;
+	}
+
+	ThreadMetrics& metrics = getThreadMetrics();
+	addToMetric(metrics.counts[COUNTER_FILES_HASHED], 1);
+	addToMetric(metrics.latencyBuckets[bucket], 1);
+	addToMetric(metrics.latencyNanoseconds, nanoseconds);
+}
+
+// Sums the metrics of the running threads and the exited ones
+// The ticks per second are measured over the whole time since the first thread metrics were created
+void takeMetricsSnapshot(MetricsSnapshot& snapshot)
+{
+	MetricsRegistry& registry = getMetricsRegistry();
+	lock_guard<mutex> lock(registry.threadsMutex);
+
+	snapshot = registry.exitedTotals;
+	for (const ThreadMetrics* metrics : registry.threads)
+	{
+		addThreadMetrics(*metrics, snapshot);
+	}
+
+	unsigned long long elapsedTicks = readMetricsTicks() - registry.startTicks;
+	unsigned long long elapsedNanoseconds = readMetricsNanoseconds() - registry.startNanoseconds;
+	snapshot.ticksPerSecond = elapsedNanoseconds == 0 ? NANOSECONDS_IN_SECOND : elapsedTicks * NANOSECONDS_IN_SECOND / elapsedNanoseconds;
+}
+
+// Returns the upper bound of a latency bucket in seconds
+double getBucketSeconds(size_t bucket)
+{
+	return (double)(1ULL << bucket) * SECONDS_IN_MICROSECOND;
+}
+
+// Writes a snapshot as a JSON object
+void writeMetricsJson(ostream& output, const MetricsSnapshot& snapshot)
+{
+	output << "{\n  \"counters\": {";
+	for (size_t i = 0; i < COUNTERS_COUNT; i++)
+	{
+		output << (i == 0 ? "\n" : ",\n") << "    \"" << COUNTER_NAMES[i] << "\": " << snapshot.counts[i];
+	}
+
+	output << "\n  },\n  \"stage_seconds\": {";
+	for (size_t i = 0; i < STAGES_COUNT; i++)
+	{
+		output << (i == 0 ? "\n" : ",\n") << "    \"" << STAGE_NAMES[i] << "\": " << snapshot.stageTicks[i] / snapshot.ticksPerSecond;
+	}
+
+	output << "\n  },\n  \"file_latency_seconds\": {\n";
+	output << "    \"count\": " << snapshot.counts[COUNTER_FILES_HASHED] << ",\n";
+	output << "    \"sum\": " << snapshot.latencyNanoseconds / NANOSECONDS_IN_SECOND << ",\n";
+	output << "    \"buckets\": [";
+	for (size_t i = 0; i < LATENCY_BUCKETS_COUNT; i++)
+	{
+		output << (i == 0 ? "\n" : ",\n") << "      { \"le\": ";
+		if (i == LATENCY_BUCKETS_COUNT - 1)
+		{
+			output << "null";
+		}
+		else
+		{
+			output << getBucketSeconds(i);
+		}
+		output << ", \"count\": " << snapshot.latencyBuckets[i] << " }";
+	}
+	output << "\n    ]\n  }\n}\n";
+}
+
+// Writes a snapshot in the Prometheus text format, with a cumulative histogram of the file latencies
+void writeMetricsPrometheus(ostream& output, const MetricsSnapshot& snapshot)
+{
+	for (size_t i = 0; i < COUNTERS_COUNT; i++)
+	{
+		output << "# HELP sha256_" << COUNTER_NAMES[i] << "_total " << COUNTER_DESCRIPTIONS[i] << '\n';
+		output << "# TYPE sha256_" << COUNTER_NAMES[i] << "_total counter\n";
+		output << "sha256_" << COUNTER_NAMES[i] << "_total " << snapshot.counts[i] << '\n';
+	}
+
+	output << "# HELP sha256_stage_seconds_total Time spent in each hashing stage, summed over all threads\n";
+	output << "# TYPE sha256_stage_seconds_total counter\n";
+	for (size_t i = 0; i < STAGES_COUNT; i++)
+	{
+		output << "sha256_stage_seconds_total{stage=\"" << STAGE_NAMES[i] << "\"} " << snapshot.stageTicks[i] / snapshot.ticksPerSecond << '\n';
+	}
+
+	output << "# HELP sha256_file_latency_seconds Time to hash one whole file\n";
+	output << "# TYPE sha256_file_latency_seconds histogram\n";
+	unsigned long long cumulativeCount = 0;
+	for (size_t i = 0; i < LATENCY_BUCKETS_COUNT; i++)
+	{
+		cumulativeCount += snapshot.latencyBuckets[i];
+		output << "sha256_file_latency_seconds_bucket{le=\"";
+		if (i == LATENCY_BUCKETS_COUNT - 1)
+		{
+			output << "+Inf";
+		}
+		else
+		{
+			output << getBucketSeconds(i);
+		}
+		output << "\"} " << cumulativeCount << '\n';
+	}
+	output << "sha256_file_latency_seconds_sum " << snapshot.latencyNanoseconds / NANOSECONDS_IN_SECOND << '\n';
+	output << "sha256_file_latency_seconds_count " << snapshot.counts[COUNTER_FILES_HASHED] << '\n';
+}
+
+// Writes the metrics collected so far to a file - as JSON if its name ends with ".json" and in the Prometheus text format otherwise
+// Returns false if the file can't be written
+bool writeMetricsFile(const char* path)
+{
+	MetricsSnapshot snapshot;
+	takeMetricsSnapshot(snapshot);
+
+	ofstream output(path, ios::trunc);
+	if (!output)
+	{
+		return false;
+	}
+
+	string name = path;
+	size_t extensionSize = string(JSON_EXTENSION).size();
+	if (name.size() >= extensionSize && name.compare(name.size() - extensionSize, extensionSize, JSON_EXTENSION) == 0)
+	{
+		writeMetricsJson(output, snapshot);
+	}
+	else
+	{
+		writeMetricsPrometheus(output, snapshot);
+	}
+
+	output.close();
+	return !output.fail();
+}
+
+#else
+
+// The metrics are compiled out, so there is nothing to turn on
+void enableMetrics()
+{
+}
+
+// The metrics are compiled out, so there is nothing to write
+bool writeMetricsFile(const char*)
+{
+	return false;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,132 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the declarations of the hot path instrumentation
+* Every thread counts into its own cache line aligned block, so the counters never share a cache line between threads
+* The instrumentation is off until enableMetrics is called, and until then it costs a single branch per context call
+* Defining SHA256_NO_METRICS compiles all of the instrumentation out
+*
+*/
+
+#pragma once
+
+#include <cstddef>
+
+#ifndef SHA256_NO_METRICS
+
+#include <atomic>
+
+#include "CpuFeatures.h"
+
+#ifdef SHA256_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#else
+#include <chrono>
+#endif
+
+#endif
+
+// The counted events
+enum MetricsCounter
+{
+	COUNTER_BYTES_READ,
+	COUNTER_BLOCKS_COMPRESSED,
+	COUNTER_MESSAGES_PADDED,
+	COUNTER_DIGESTS_FORMATTED,
+	COUNTER_FILES_HASHED,
+	COUNTERS_COUNT
+};
+
+// The timed stages of hashing
+// The reading runs on the reader thread of the pipeline, so its time overlaps with the compression of a file
+enum MetricsStage
+{
+	STAGE_READ,
+	STAGE_PAD,
+	STAGE_COMPRESS,
+	STAGE_FORMAT,
+	STAGES_COUNT
+};
+
+// The file latency histogram has a bucket for each power of two microseconds up to about 17 seconds and one above
+const size_t LATENCY_BUCKETS_COUNT = 26;
+const size_t METRICS_CACHE_LINE_BYTES = 64;
+
+void enableMetrics();
+bool writeMetricsFile(const char* path);
+
+#ifndef SHA256_NO_METRICS
+
+// Set once by enableMetrics before any hashing starts, so the threads only ever read it
+extern bool isMetricsEnabled;
+
+// The metrics of one thread
+// Only the owning thread writes them, so the atomics are only used to make the reads of other threads safe
+struct alignas(METRICS_CACHE_LINE_BYTES) ThreadMetrics
+{
+	std::atomic<unsigned long long> counts[COUNTERS_COUNT];
+	std::atomic<unsigned long long> stageTicks[STAGES_COUNT];
+	std::atomic<unsigned long long> latencyBuckets[LATENCY_BUCKETS_COUNT];
+	std::atomic<unsigned long long> latencyNanoseconds;
+
+	ThreadMetrics();
+	~ThreadMetrics();
+};
+
+// Returns the metrics of the calling thread, which are registered on its first use and merged into the totals when it exits
+inline ThreadMetrics& getThreadMetrics()
+{
+	thread_local ThreadMetrics metrics;
+
+	return metrics;
+}
+
+// Adds an amount to a metric of the calling thread without a locked instruction
+inline void addToMetric(std::atomic<unsigned long long>& metric, unsigned long long amount)
+{
+	metric.store(metric.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+// Reads the clock of the stage timings - the time stamp counter on x86 and a nanoseconds clock elsewhere
+// The ticks are converted to seconds only when the metrics are written
+inline unsigned long long readMetricsTicks()
+{
+#ifdef SHA256_X86
+	return __rdtsc();
+#else
+	return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void addFileLatency(unsigned long long nanoseconds);
+unsigned long long readMetricsNanoseconds();
+
+#define METRICS_IS_ENABLED() (isMetricsEnabled)
+#define METRICS_COUNT(counter, amount) do { if (isMetricsEnabled) { addToMetric(getThreadMetrics().counts[counter], (amount)); } } while (false)
+#define METRICS_START(name) unsigned long long name = isMetricsEnabled ? readMetricsTicks() : 0
+#define METRICS_STOP(stage, name) do { if (isMetricsEnabled) { addToMetric(getThreadMetrics().stageTicks[stage], readMetricsTicks() - (name)); } } while (false)
+#define METRICS_FILE_START(name) unsigned long long name = isMetricsEnabled ? readMetricsNanoseconds() : 0
+#define METRICS_FILE_STOP(name) do { if (isMetricsEnabled) { addFileLatency(readMetricsNanoseconds() - (name)); } } while (false)
+
+#else
+
+#define METRICS_IS_ENABLED() (false)
+#define METRICS_COUNT(counter, amount) do { } while (false)
+#define METRICS_START(name) do { } while (false)
+#define METRICS_STOP(stage, name) do { } while (false)
+#define METRICS_FILE_START(name) do { } while (false)
+#define METRICS_FILE_STOP(name) do { } while (false)
+
+#endif
\ No newline at end of file
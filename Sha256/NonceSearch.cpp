@@ -0,0 +1,537 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the double SHA256 nonce search over 80 byte block headers
+* The nonce is the little-endian word at NONCE_OFFSET, and digests are compared with the target as
+* 256 bit little-endian numbers, the same way block hashes are compared in Bitcoin
+*
+*/
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "NonceSearch.h"
+#include "Sha256Kernels.h"
+
+using namespace std;
+
+typedef unsigned char byte;
+typedef unsigned int word32;
+
+const size_t NONCE_WORD_INDEX = (NONCE_OFFSET - MESSAGE_BLOCK_BYTES) / BYTES_IN_WORD;
+const size_t NONCE_FREE_ROUNDS_COUNT = NONCE_WORD_INDEX;
+const size_t NONCE_FREE_SCHEDULE_WORDS = MESSAGE_BLOCK_WORDS + 2;
+const size_t NONCE_SIGMA_SCHEDULE_INDEX = NONCE_FREE_SCHEDULE_WORDS;
+const size_t NONCE_SCHEDULE_INDEX = NONCE_FREE_SCHEDULE_WORDS + 1;
+const size_t EARLY_REJECTION_ROUNDS_COUNT = SCHEDULE_WORDS_COUNT - 3;
+const size_t LAST_STATE_WORD = RESULT_WORDS_COUNT - 1;
+const size_t MAX_NONCE_LANES_COUNT = AVX512_LANES_COUNT;
+
+// How many nonces a worker takes at once
+const unsigned long long NONCE_CHUNK_SIZE = 1 << 16;
+
+// Everything about the two hashes of a header that doesn't change with the nonce
+struct NonceTemplate
+{
+	// The state registers after the first block of the header
+	word32 midstate[RESULT_WORDS_COUNT];
+
+	// The padded second block of the header, as bytes for the block kernels and as words for the rounds
+	byte secondBlock[MESSAGE_BLOCK_BYTES];
+	word32 secondSchedule[SCHEDULE_WORDS_COUNT];
+
+	// The state registers of the second block after the rounds that come before the nonce word
+	word32 secondRoundState[RESULT_WORDS_COUNT];
+
+	// The padded block of the second hash, only its first DIGEST_BYTES bytes change with the nonce
+	byte hashBlock[MESSAGE_BLOCK_BYTES];
+	word32 hashSchedule[SCHEDULE_WORDS_COUNT];
+
+	Digest target;
+	word32 targetTopWord;
+};
+
+// The search shared between the workers
+struct NonceSearch
+{
+	NonceTemplate nonceTemplate;
+	unsigned int firstNonce;
+	unsigned long long noncesCount;
+	LaneRoundsKernel roundsKernel;
+	LanesKernel kernel;
+	size_t lanesCount;
+
+	atomic<unsigned long long> nextChunk;
+	atomic<unsigned long long> hashesCount;
+	atomic<bool> isFound;
+
+	mutex resultMutex;
+	unsigned long long foundOffset;
+	Digest foundDigest;
+};
+
+// Reverses the byte order of a word
+inline word32 swapWordBytes(word32 word)
+{
+	return (word >> 24) | ((word >> 8) & 0x0000ff00) | ((word << 8) & 0x00ff0000) | (word << 24);
+}
+
+// Hashes the given rounds of a message block over the state registers
+inline void hashNonceRounds(word32* state, const word32* schedule, size_t firstRound, size_t lastRound)
+{
+	word32 a = state[0], b = state[1], c = state[2], d = state[3];
+	word32 e = state[4], f = state[5], g = state[6], h = state[7];
+
+	for (size_t i = firstRound; i < lastRound; i++)
+	{
+		word32 firstTempWord = h + upperSigmaOne(e) + choose(e, f, g) + CUBE_ROOT_CONSTANTS[i] + schedule[i];
+		word32 secondTempWord = upperSigmaZero(a) + majority(a, b, c);
+
+		h = g;
+		g = f;
+		f = e;
+		e = d + firstTempWord;
+		d = c;
+		c = b;
+		b = a;
+		a = firstTempWord + secondTempWord;
+	}
+
+	state[0] = a; state[1] = b; state[2] = c; state[3] = d;
+	state[4] = e; state[5] = f; state[6] = g; state[7] = h;
+}
+
+// Generates the schedule words from the given index on
+inline void expandNonceSchedule(word32* schedule, size_t firstIndex)
+{
+	for (size_t i = firstIndex; i < SCHEDULE_WORDS_COUNT; i++)
+	{
+		schedule[i] = lowerSigmaOne(schedule[i - 2]) + schedule[i - 7] + lowerSigmaZero(schedule[i - 15]) + schedule[i - 16];
+	}
+}
+
+// Reads the words of a message block
+void loadBlockWords(const byte* block, word32* words)
+{
+	for (size_t i = 0; i < MESSAGE_BLOCK_WORDS; i++)
+	{
+		const byte* bytes = block + i * BYTES_IN_WORD;
+		words[i] = ((word32)bytes[0] << 24) | ((word32)bytes[1] << 16) | ((word32)bytes[2] << 8) | (word32)bytes[3];
+	}
+}
+
+// Writes a nonce to its little-endian place in the second block of a header
+void writeNonce(byte* secondBlock, word32 nonce)
+{
+	byte* nonceBytes = secondBlock + (NONCE_OFFSET - MESSAGE_BLOCK_BYTES);
+	for (size_t i = 0; i < BYTES_IN_WORD; i++)
+	{
+		nonceBytes[i] = (byte)(nonce >> (i * BYTE_SIZE));
+	}
+}
+
+// Hashes everything about a header that doesn't depend on its nonce
+void prepareNonceTemplate(const byte* header, const Digest& target, NonceTemplate& nonceTemplate)
+{
+	for (size_t i = 0; i < RESULT_WORDS_COUNT; i++)
+	{
+		nonceTemplate.midstate[i] = INITIAL_HASH_VALUES[i];
+	}
+	hashMessageBlocks(header, 1, nonceTemplate.midstate);
+
+	byte finalBlocks[FINAL_BLOCKS_MAX_BYTES];
+	createFinalBlocks(header + MESSAGE_BLOCK_BYTES, BLOCK_HEADER_BYTES - MESSAGE_BLOCK_BYTES, BLOCK_HEADER_BYTES, finalBlocks);
+	for (size_t i = 0; i < MESSAGE_BLOCK_BYTES; i++)
+	{
+		nonceTemplate.secondBlock[i] = finalBlocks[i];
+	}
+
+	// Except for the nonce word, the block words and the first two generated words don't depend on the nonce
+	// With a zero nonce word the next two generated words hold exactly their parts that don't depend on it
+	word32* schedule = nonceTemplate.secondSchedule;
+	loadBlockWords(nonceTemplate.secondBlock, schedule);
+	schedule[NONCE_WORD_INDEX] = 0;
+	expandNonceSchedule(schedule, MESSAGE_BLOCK_WORDS);
+
+	for (size_t i = 0; i < RESULT_WORDS_COUNT; i++)
+	{
+		nonceTemplate.secondRoundState[i] = nonceTemplate.midstate[i];
+	}
+	hashNonceRounds(nonceTemplate.secondRoundState, schedule, 0, NONCE_FREE_ROUNDS_COUNT);
+
+	Digest emptyDigest = { { 0 } };
+	createFinalBlocks(emptyDigest.bytes, DIGEST_BYTES, DIGEST_BYTES, finalBlocks);
+	for (size_t i = 0; i < MESSAGE_BLOCK_BYTES; i++)
+	{
+		nonceTemplate.hashBlock[i] = finalBlocks[i];
+	}
+	loadBlockWords(nonceTemplate.hashBlock, nonceTemplate.hashSchedule);
+
+	nonceTemplate.target = target;
+	nonceTemplate.targetTopWord = ((word32)target.bytes[DIGEST_BYTES - 1] << 24) |
+		((word32)target.bytes[DIGEST_BYTES - 2] << 16) |
+		((word32)target.bytes[DIGEST_BYTES - 3] << 8) |
+		(word32)target.bytes[DIGEST_BYTES - 4];
+}
+
+// Hashes a header with the given nonce with the scalar rounds
+// The schedule words and the rounds that don't depend on the nonce are taken from the template, and the second
+// hash is stopped early when its last state register already shows that the digest is above the target
+// Returns true and writes the digest if the digest is within the target
+bool hashNonceScalar(const NonceTemplate& nonceTemplate, word32 nonce, Digest& digest)
+{
+	word32 schedule[SCHEDULE_WORDS_COUNT];
+	for (size_t i = 0; i < NONCE_FREE_SCHEDULE_WORDS; i++)
+	{
+		schedule[i] = nonceTemplate.secondSchedule[i];
+	}
+
+	word32 nonceWord = swapWordBytes(nonce);
+	schedule[NONCE_WORD_INDEX] = nonceWord;
+	schedule[NONCE_SIGMA_SCHEDULE_INDEX] = nonceTemplate.secondSchedule[NONCE_SIGMA_SCHEDULE_INDEX] + lowerSigmaZero(nonceWord);
+	schedule[NONCE_SCHEDULE_INDEX] = nonceTemplate.secondSchedule[NONCE_SCHEDULE_INDEX] + nonceWord;
+	expandNonceSchedule(schedule, NONCE_SCHEDULE_INDEX + 1);
+
+	word32 state[RESULT_WORDS_COUNT];
+	for (size_t i = 0; i < RESULT_WORDS_COUNT; i++)
+	{
+		state[i] = nonceTemplate.secondRoundState[i];
+	}
+	hashNonceRounds(state, schedule, NONCE_FREE_ROUNDS_COUNT, SCHEDULE_WORDS_COUNT);
+
+	for (size_t i = 0; i < RESULT_WORDS_COUNT; i++)
+	{
+		schedule[i] = nonceTemplate.midstate[i] + state[i];
+	}
+	for (size_t i = RESULT_WORDS_COUNT; i < MESSAGE_BLOCK_WORDS; i++)
+	{
+		schedule[i] = nonceTemplate.hashSchedule[i];
+	}
+	expandNonceSchedule(schedule, MESSAGE_BLOCK_WORDS);
+
+	for (size_t i = 0; i < RESULT_WORDS_COUNT; i++)
+	{
+		state[i] = INITIAL_HASH_VALUES[i];
+	}
+	hashNonceRounds(state, schedule, 0, EARLY_REJECTION_ROUNDS_COUNT);
+
+	// The register that becomes the last one after the remaining three rounds is already known
+	word32 lastWord = INITIAL_HASH_VALUES[LAST_STATE_WORD] + state[4];
+	if (swapWordBytes(lastWord) > nonceTemplate.targetTopWord)
+	{
+		return false;
+	}
+
+	hashNonceRounds(state, schedule, EARLY_REJECTION_ROUNDS_COUNT, SCHEDULE_WORDS_COUNT);
+	for (size_t i = 0; i < RESULT_WORDS_COUNT; i++)
+	{
+		state[i] += INITIAL_HASH_VALUES[i];
+	}
+
+	storeDigest(state, digest);
+	return isDigestWithinTarget(digest, nonceTemplate.target);
+}
+
+// Searches the given range of nonce offsets with the scalar rounds
+// Returns true and the first offset within the target if there is one
+bool searchNonceRangeScalar(const NonceSearch& search, unsigned long long start, unsigned long long end, unsigned long long& offset, Digest& digest)
+{
+	for (unsigned long long i = start; i < end; i++)
+	{
+		if (hashNonceScalar(search.nonceTemplate, (word32)(search.firstNonce + i), digest))
+		{
+			offset = i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Searches the given range of nonce offsets with a lane rounds kernel, one nonce per lane
+// Like the scalar search, the rounds before the nonce word are skipped and the second hash stops three rounds early
+// The few lanes that pass the early rejection are hashed again with the scalar rounds to get their whole digest
+// Returns true and the first offset within the target if there is one
+bool searchNonceRangeInLaneRounds(const NonceSearch& search, unsigned long long start, unsigned long long end, unsigned long long& offset, Digest& digest)
+{
+	const NonceTemplate& nonceTemplate = search.nonceTemplate;
+	size_t lanesCount = search.lanesCount;
+
+	word32 secondWords[MESSAGE_BLOCK_WORDS * MAX_NONCE_LANES_COUNT];
+	word32 hashWords[MESSAGE_BLOCK_WORDS * MAX_NONCE_LANES_COUNT];
+	word32 laneStates[RESULT_WORDS_COUNT * MAX_NONCE_LANES_COUNT];
+
+	for (size_t i = 0; i < MESSAGE_BLOCK_WORDS; i++)
+	{
+		for (size_t lane = 0; lane < lanesCount; lane++)
+		{
+			secondWords[i * lanesCount + lane] = nonceTemplate.secondSchedule[i];
+			hashWords[i * lanesCount + lane] = nonceTemplate.hashSchedule[i];
+		}
+	}
+
+	for (unsigned long long batch = start; batch < end; batch += lanesCount)
+	{
+		for (size_t lane = 0; lane < lanesCount; lane++)
+		{
+			secondWords[NONCE_WORD_INDEX * lanesCount + lane] = swapWordBytes((word32)(search.firstNonce + batch + lane));
+			for (size_t i = 0; i < RESULT_WORDS_COUNT; i++)
+			{
+				laneStates[i * lanesCount + lane] = nonceTemplate.secondRoundState[i];
+			}
+		}
+
+		search.roundsKernel(secondWords, laneStates, NONCE_FREE_ROUNDS_COUNT, SCHEDULE_WORDS_COUNT);
+
+		for (size_t i = 0; i < RESULT_WORDS_COUNT; i++)
+		{
+			for (size_t lane = 0; lane < lanesCount; lane++)
+			{
+				hashWords[i * lanesCount + lane] = nonceTemplate.midstate[i] + laneStates[i * lanesCount + lane];
+				laneStates[i * lanesCount + lane] = INITIAL_HASH_VALUES[i];
+			}
+		}
+
+		search.roundsKernel(hashWords, laneStates, 0, EARLY_REJECTION_ROUNDS_COUNT);
+
+		for (size_t lane = 0; lane < lanesCount && batch + lane < end; lane++)
+		{
+			word32 lastWord = INITIAL_HASH_VALUES[LAST_STATE_WORD] + laneStates[4 * lanesCount + lane];
+			if (swapWordBytes(lastWord) > nonceTemplate.targetTopWord)
+			{
+				continue;
+			}
+
+			if (hashNonceScalar(nonceTemplate, (word32)(search.firstNonce + batch + lane), digest))
+			{
+				offset = batch + lane;
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+// Searches the given range of nonce offsets with a block kernel, one nonce per lane
+// Returns true and the first offset within the target if there is one
+bool searchNonceRangeInLanes(const NonceSearch& search, unsigned long long start, unsigned long long end, unsigned long long& offset, Digest& digest)
+{
+	const NonceTemplate& nonceTemplate = search.nonceTemplate;
+	size_t lanesCount = search.lanesCount;
+
+	byte secondBlocks[MAX_NONCE_LANES_COUNT][MESSAGE_BLOCK_BYTES];
+	byte hashBlocks[MAX_NONCE_LANES_COUNT][MESSAGE_BLOCK_BYTES];
+	const byte* secondBlockPointers[MAX_NONCE_LANES_COUNT];
+	const byte* hashBlockPointers[MAX_NONCE_LANES_COUNT];
+	word32 laneStates[RESULT_WORDS_COUNT * MAX_NONCE_LANES_COUNT];
+
+	for (size_t lane = 0; lane < lanesCount; lane++)
+	{
+		for (size_t i = 0; i < MESSAGE_BLOCK_BYTES; i++)
+		{
+			secondBlocks[lane][i] = nonceTemplate.secondBlock[i];
+			hashBlocks[lane][i] = nonceTemplate.hashBlock[i];
+		}
+
+		secondBlockPointers[lane] = secondBlocks[lane];
+		hashBlockPointers[lane] = hashBlocks[lane];
+	}
+
+	for (unsigned long long batch = start; batch < end; batch += lanesCount)
+	{
+		for (size_t lane = 0; lane < lanesCount; lane++)
+		{
+			writeNonce(secondBlocks[lane], (word32)(search.firstNonce + batch + lane));
+			for (size_t i = 0; i < RESULT_WORDS_COUNT; i++)
+			{
+				laneStates[i * lanesCount + lane] = nonceTemplate.midstate[i];
+			}
+		}
+
+		search.kernel(secondBlockPointers, laneStates);
+
+		for (size_t lane = 0; lane < lanesCount; lane++)
+		{
+			word32 state[RESULT_WORDS_COUNT];
+			for (size_t i = 0; i < RESULT_WORDS_COUNT; i++)
+			{
+				state[i] = laneStates[i * lanesCount + lane];
+				laneStates[i * lanesCount + lane] = INITIAL_HASH_VALUES[i];
+			}
+
+			Digest firstDigest;
+			storeDigest(state, firstDigest);
+			for (size_t i = 0; i < DIGEST_BYTES; i++)
+			{
+				hashBlocks[lane][i] = firstDigest.bytes[i];
+			}
+		}
+
+		search.kernel(hashBlockPointers, laneStates);
+
+		for (size_t lane = 0; lane < lanesCount && batch + lane < end; lane++)
+		{
+			word32 state[RESULT_WORDS_COUNT];
+			for (size_t i = 0; i < RESULT_WORDS_COUNT; i++)
+			{
+				state[i] = laneStates[i * lanesCount + lane];
+			}
+
+			storeDigest(state, digest);
+			if (isDigestWithinTarget(digest, nonceTemplate.target))
+			{
+				offset = batch + lane;
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+// Adapts the single message kernel to the lanes interface with a single lane
+void hashSingleLaneBlock(const byte* const* laneBlocks, word32* laneStates)
+{
+	hashMessageBlocks(laneBlocks[0], 1, laneStates);
+}
+
+// Takes the next chunk of nonces until there are none left or a worker has found a nonce
+// Chunks are taken in order and always searched to the end, so the lowest nonce within the target is found
+void searchNonceWorker(NonceSearch& search)
+{
+	unsigned long long chunk = search.nextChunk++;
+	while (!search.isFound)
+	{
+		unsigned long long start = chunk * NONCE_CHUNK_SIZE;
+		if (start >= search.noncesCount)
+		{
+			break;
+		}
+
+		unsigned long long end = start + NONCE_CHUNK_SIZE < search.noncesCount ? start + NONCE_CHUNK_SIZE : search.noncesCount;
+
+		unsigned long long offset = 0;
+		Digest digest;
+		bool isFound = false;
+		if (search.roundsKernel != nullptr)
+		{
+			isFound = searchNonceRangeInLaneRounds(search, start, end, offset, digest);
+		}
+		else if (search.kernel != nullptr)
+		{
+			isFound = searchNonceRangeInLanes(search, start, end, offset, digest);
+		}
+		else
+		{
+			isFound = searchNonceRangeScalar(search, start, end, offset, digest);
+		}
+
+		search.hashesCount += (isFound ? offset + 1 : end) - start;
+
+		if (isFound)
+		{
+			lock_guard<mutex> lock(search.resultMutex);
+			if (!search.isFound || offset < search.foundOffset)
+			{
+				search.foundOffset = offset;
+				search.foundDigest = digest;
+			}
+			search.isFound = true;
+		}
+
+		chunk = search.nextChunk++;
+	}
+}
+
+// Hashes an 80 byte block header twice
+void hashBlockHeader(const unsigned char* header, Digest& digest)
+{
+	Digest firstDigest;
+	hashBytesDigest(header, BLOCK_HEADER_BYTES, firstDigest);
+	hashBytesDigest(firstDigest.bytes, DIGEST_BYTES, digest);
+}
+
+// Checks whether a digest is at most the target when both are read as 256 bit little-endian numbers
+bool isDigestWithinTarget(const Digest& digest, const Digest& target)
+{
+	for (size_t i = DIGEST_BYTES; i > 0; i--)
+	{
+		if (digest.bytes[i - 1] != target.bytes[i - 1])
+		{
+			return digest.bytes[i - 1] < target.bytes[i - 1];
+		}
+	}
+
+	return true;
+}
+
+// Searches for the lowest nonce, starting from the one already in the header, whose double hash is within the target
+// Up to the given amount of nonces are tried by the given amount of workers
+// Uses the multi-buffer lane rounds or the SHA extensions when they are supported and the scalar rounds otherwise
+// The precomputed rounds and the early rejection are used by the lane rounds and the scalar rounds, the SHA extensions
+// hash both blocks whole
+void searchNonce(
+	const unsigned char* header, const Digest& target,
+	unsigned long long noncesCount, unsigned int workersCount,
+	NonceSearchResult& result)
+{
+	result.isFound = false;
+	result.nonce = 0;
+	result.hashesCount = 0;
+	result.seconds = 0;
+
+	if (header == nullptr || workersCount == 0)
+	{
+		return;
+	}
+
+	chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+
+	NonceSearch search;
+	prepareNonceTemplate(header, target, search.nonceTemplate);
+	search.firstNonce = (word32)header[NONCE_OFFSET] |
+		((word32)header[NONCE_OFFSET + 1] << 8) |
+		((word32)header[NONCE_OFFSET + 2] << 16) |
+		((word32)header[NONCE_OFFSET + 3] << 24);
+	search.noncesCount = noncesCount;
+	search.roundsKernel = selectLaneRoundsKernel(search.lanesCount);
+	search.kernel = nullptr;
+	if (search.roundsKernel == nullptr && isShaNiSupported())
+	{
+		search.kernel = hashSingleLaneBlock;
+		search.lanesCount = 1;
+	}
+	search.nextChunk = 0;
+	search.hashesCount = 0;
+	search.isFound = false;
+	search.foundOffset = 0;
+
+	vector<thread> workers;
+	for (unsigned int i = 0; i < workersCount; i++)
+	{
+		workers.emplace_back(searchNonceWorker, ref(search));
+	}
+
+	for (thread& worker : workers)
+	{
+		worker.join();
+	}
+
+	result.isFound = search.isFound;
+	result.nonce = (word32)(search.firstNonce + search.foundOffset);
+	result.digest = search.foundDigest;
+	result.hashesCount = search.hashesCount;
+	result.seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+}
\ No newline at end of file
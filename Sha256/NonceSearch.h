@@ -0,0 +1,41 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the declarations of the double SHA256 nonce search over 80 byte block headers
+*
+*/
+
+#pragma once
+
+#include <cstddef>
+
+#include "SHA256.h"
+
+const size_t BLOCK_HEADER_BYTES = 80;
+const size_t NONCE_OFFSET = 76;
+
+// The outcome of a nonce search
+// The nonce is only valid if one has been found, the counters are always filled in
+struct NonceSearchResult
+{
+	bool isFound;
+	unsigned int nonce;
+	Digest digest;
+	unsigned long long hashesCount;
+	double seconds;
+};
+
+void hashBlockHeader(const unsigned char* header, Digest& digest);
+bool isDigestWithinTarget(const Digest& digest, const Digest& target);
+void searchNonce(
+	const unsigned char* header, const Digest& target,
+	unsigned long long noncesCount, unsigned int workersCount,
+	NonceSearchResult& result);
\ No newline at end of file
@@ -0,0 +1,298 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains PBKDF2-HMAC-SHA256
+* Every iteration hashes a 32 byte message after a cached key midstate, so it is a single compression of a block
+* whose padding never changes - only the first 32 bytes of the block are rewritten
+* The output blocks of all derivations are independent, so they share the multi-buffer lanes
+*
+*/
+
+#include <vector>
+
+#include "Hmac.h"
+#include "Pbkdf2.h"
+#include "Sha256Constexpr.h"
+#include "Sha256Kernels.h"
+
+using namespace std;
+
+typedef unsigned char byte;
+typedef unsigned int word32;
+
+const size_t MAX_LANES_COUNT = AVX512_LANES_COUNT;
+const size_t BLOCK_INDEX_BYTES = 4;
+
+// The bits of the 32 byte message after the 64 byte key block, which end every padded iteration block
+const unsigned long long ITERATION_MESSAGE_BITS = (MESSAGE_BLOCK_BYTES + DIGEST_BYTES) * BYTE_SIZE;
+
+// One output block of one derivation
+// The last HMAC result and the XOR of all results so far are kept as state registers between the iterations
+struct Pbkdf2Block
+{
+	const HmacKey* key;
+	word32 lastResult[RESULT_WORDS_COUNT];
+	word32 xorResult[RESULT_WORDS_COUNT];
+	byte* output;
+	size_t outputSize;
+};
+
+// Fills the padding of an iteration block - the end marker after the 32 byte message and the length of the HMAC input
+void initIterationBlock(byte* block)
+{
+	for (size_t i = DIGEST_BYTES; i < MESSAGE_BLOCK_BYTES; i++)
+	{
+		block[i] = 0;
+	}
+	block[DIGEST_BYTES] = 0x80;
+
+	for (size_t i = 0; i < LENGTH_BYTES_COUNT; i++)
+	{
+		block[MESSAGE_BLOCK_BYTES - 1 - i] = (byte)(ITERATION_MESSAGE_BITS >> (i * BYTE_SIZE));
+	}
+}
+
+// Writes the state registers as the big-endian message at the start of an iteration block
+void storeIterationMessage(const word32* state, byte* block)
+{
+	for (size_t i = 0; i < RESULT_WORDS_COUNT; i++)
+	{
+		block[i * BYTES_IN_WORD] = (byte)(state[i] >> 24);
+		block[i * BYTES_IN_WORD + 1] = (byte)(state[i] >> 16);
+		block[i * BYTES_IN_WORD + 2] = (byte)(state[i] >> 8);
+		block[i * BYTES_IN_WORD + 3] = (byte)state[i];
+	}
+}
+
+// Calculates the first HMAC of an output block - over the salt and the big-endian block index starting from 1
+void startPbkdf2Block(Pbkdf2Block& block, const void* salt, size_t saltSize, unsigned long long blockIndex)
+{
+	byte indexBytes[BLOCK_INDEX_BYTES];
+	for (size_t i = 0; i < BLOCK_INDEX_BYTES; i++)
+	{
+		indexBytes[i] = (byte)(blockIndex >> ((BLOCK_INDEX_BYTES - i - 1) * BYTE_SIZE));
+	}
+
+	HmacContext context;
+	initHmacContext(context, *block.key);
+	updateHmacContext(context, salt, saltSize);
+	updateHmacContext(context, indexBytes, BLOCK_INDEX_BYTES);
+
+	Digest digest;
+	finalHmacContext(context, digest);
+
+	for (size_t i = 0; i < RESULT_WORDS_COUNT; i++)
+	{
+		const byte* wordBytes = digest.bytes + i * BYTES_IN_WORD;
+		block.lastResult[i] = ((word32)wordBytes[0] << 24) | ((word32)wordBytes[1] << 16) | ((word32)wordBytes[2] << 8) | wordBytes[3];
+		block.xorResult[i] = block.lastResult[i];
+	}
+}
+
+// Writes the XOR of the results of an output block to its part of the output, truncated to its size
+void finishPbkdf2Block(const Pbkdf2Block& block)
+{
+	byte bytes[DIGEST_BYTES];
+	storeIterationMessage(block.xorResult, bytes);
+
+	for (size_t i = 0; i < block.outputSize; i++)
+	{
+		block.output[i] = bytes[i];
+	}
+}
+
+// Runs the remaining iterations of an output block with the single message kernel
+// Each iteration is the inner and then the outer compression of the same padded block
+void iteratePbkdf2Block(Pbkdf2Block& block, unsigned int iterations)
+{
+	byte iterationBlock[MESSAGE_BLOCK_BYTES];
+	initIterationBlock(iterationBlock);
+
+	for (unsigned int iteration = 1; iteration < iterations; iteration++)
+	{
+		word32 state[RESULT_WORDS_COUNT];
+
+		storeIterationMessage(block.lastResult, iterationBlock);
+		for (size_t i = 0; i < RESULT_WORDS_COUNT; i++)
+		{
+			state[i] = block.key->innerPrefix.state[i];
+		}
+		hashMessageBlocks(iterationBlock, 1, state);
+
+		storeIterationMessage(state, iterationBlock);
+		for (size_t i = 0; i < RESULT_WORDS_COUNT; i++)
+		{
+			state[i] = block.key->outerPrefix.state[i];
+		}
+		hashMessageBlocks(iterationBlock, 1, state);
+
+		for (size_t i = 0; i < RESULT_WORDS_COUNT; i++)
+		{
+			block.lastResult[i] = state[i];
+			block.xorResult[i] ^= state[i];
+		}
+	}
+}
+
+// Runs the remaining iterations of up to lanesCount output blocks together, one block per lane
+// The lanes without a block repeat the first one and their results are dropped
+void iteratePbkdf2BlocksInLanes(Pbkdf2Block* blocks, size_t blocksCount, unsigned int iterations, LanesKernel kernel, size_t lanesCount)
+{
+	byte iterationBlocks[MAX_LANES_COUNT][MESSAGE_BLOCK_BYTES];
+	const byte* laneBlocks[MAX_LANES_COUNT];
+	word32 laneStates[RESULT_WORDS_COUNT * MAX_LANES_COUNT];
+	Pbkdf2Block* laneOwners[MAX_LANES_COUNT];
+
+	for (size_t lane = 0; lane < lanesCount; lane++)
+	{
+		initIterationBlock(iterationBlocks[lane]);
+		laneBlocks[lane] = iterationBlocks[lane];
+		laneOwners[lane] = lane < blocksCount ? &blocks[lane] : &blocks[0];
+	}
+
+	for (unsigned int iteration = 1; iteration < iterations; iteration++)
+	{
+		for (size_t lane = 0; lane < lanesCount; lane++)
+		{
+			storeIterationMessage(laneOwners[lane]->lastResult, iterationBlocks[lane]);
+			for (size_t i = 0; i < RESULT_WORDS_COUNT; i++)
+			{
+				laneStates[i * lanesCount + lane] = laneOwners[lane]->key->innerPrefix.state[i];
+			}
+		}
+
+		kernel(laneBlocks, laneStates);
+
+		for (size_t lane = 0; lane < lanesCount; lane++)
+		{
+			word32 state[RESULT_WORDS_COUNT];
+			for (size_t i = 0; i < RESULT_WORDS_COUNT; i++)
+			{
+				state[i] = laneStates[i * lanesCount + lane];
+				laneStates[i * lanesCount + lane] = laneOwners[lane]->key->outerPrefix.state[i];
+			}
+			storeIterationMessage(state, iterationBlocks[lane]);
+		}
+
+		kernel(laneBlocks, laneStates);
+
+		for (size_t lane = 0; lane < blocksCount; lane++)
+		{
+			for (size_t i = 0; i < RESULT_WORDS_COUNT; i++)
+			{
+				word32 result = laneStates[i * lanesCount + lane];
+				blocks[lane].lastResult[i] = result;
+				blocks[lane].xorResult[i] ^= result;
+			}
+		}
+	}
+}
+
+// Returns how many output blocks make a lane batch worth running instead of the single message kernel
+// The SHA extensions hash one block about as fast as half of the AVX-512 lanes, without them two blocks are enough
+size_t getMinLaneBlocksCount(size_t lanesCount)
+{
+	return isShaNiSupported() ? lanesCount / 2 : 2;
+}
+
+// Runs the remaining iterations of all output blocks, as many of them as possible in the multi-buffer lanes
+void iteratePbkdf2Blocks(vector<Pbkdf2Block>& blocks, unsigned int iterations)
+{
+	static size_t lanesCount = 0;
+	static const LanesKernel SELECTED_KERNEL = selectLanesKernel(lanesCount);
+
+	size_t first = 0;
+	if (SELECTED_KERNEL != nullptr)
+	{
+		size_t minLaneBlocksCount = getMinLaneBlocksCount(lanesCount);
+		while (blocks.size() - first >= minLaneBlocksCount)
+		{
+			size_t lanesBlocksCount = blocks.size() - first < lanesCount ? blocks.size() - first : lanesCount;
+			iteratePbkdf2BlocksInLanes(&blocks[first], lanesBlocksCount, iterations, SELECTED_KERNEL, lanesCount);
+			first += lanesBlocksCount;
+		}
+	}
+
+	for (size_t i = first; i < blocks.size(); i++)
+	{
+		iteratePbkdf2Block(blocks[i], iterations);
+	}
+}
+
+// Adds the output blocks of one derivation after its first iteration
+void addPbkdf2Blocks(vector<Pbkdf2Block>& blocks, const HmacKey& key, const MessageSpan& salt, unsigned char* output, size_t outputSize)
+{
+	for (size_t written = 0; written < outputSize; written += DIGEST_BYTES)
+	{
+		Pbkdf2Block block;
+		block.key = &key;
+		block.output = output + written;
+		block.outputSize = outputSize - written < DIGEST_BYTES ? outputSize - written : DIGEST_BYTES;
+		startPbkdf2Block(block, salt.data, salt.size, written / DIGEST_BYTES + 1);
+
+		blocks.push_back(block);
+	}
+}
+
+// Checks the arguments shared by the single and the batch derivation
+bool isValidPbkdf2Request(unsigned int iterations, size_t outputSize)
+{
+	return iterations > 0 && (outputSize + DIGEST_BYTES - 1) / DIGEST_BYTES <= PBKDF2_MAX_BLOCKS_COUNT;
+}
+
+// Derives the given amount of output bytes from a password and a salt with the given count of iterations
+// The output blocks of 32 bytes are iterated in separate lanes when there are enough of them
+// Returns false if there are no iterations or more than PBKDF2_MAX_BLOCKS_COUNT output blocks are requested
+bool pbkdf2(
+	const void* password, size_t passwordSize,
+	const void* salt, size_t saltSize,
+	unsigned int iterations,
+	unsigned char* output, size_t outputSize)
+{
+	MessageSpan passwordSpan = { password, passwordSize };
+	MessageSpan saltSpan = { salt, saltSize };
+
+	return pbkdf2Many(&passwordSpan, &saltSpan, 1, iterations, output, outputSize);
+}
+
+// Derives the given amount of output bytes for each password and salt pair with the same count of iterations
+// The outputs are written one after another, outputSize bytes each
+// The output blocks of all derivations are independent, so the passwords of a batch share the lanes
+// Returns false if there are no iterations or more than PBKDF2_MAX_BLOCKS_COUNT output blocks are requested
+bool pbkdf2Many(
+	const MessageSpan* passwords, const MessageSpan* salts, size_t count,
+	unsigned int iterations,
+	unsigned char* outputs, size_t outputSize)
+{
+	if (!isValidPbkdf2Request(iterations, outputSize) || (count > 0 && (passwords == nullptr || salts == nullptr || outputs == nullptr)))
+	{
+		return false;
+	}
+
+	vector<HmacKey> keys(count);
+	vector<Pbkdf2Block> blocks;
+	blocks.reserve(count * ((outputSize + DIGEST_BYTES - 1) / DIGEST_BYTES));
+
+	for (size_t i = 0; i < count; i++)
+	{
+		initHmacKey(keys[i], passwords[i].data, passwords[i].size);
+		addPbkdf2Blocks(blocks, keys[i], salts[i], outputs + i * outputSize, outputSize);
+	}
+
+	iteratePbkdf2Blocks(blocks, iterations);
+
+	for (const Pbkdf2Block& block : blocks)
+	{
+		finishPbkdf2Block(block);
+	}
+
+	return true;
+}
\ No newline at end of file
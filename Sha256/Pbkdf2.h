@@ -0,0 +1,32 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the declarations of PBKDF2-HMAC-SHA256
+*
+*/
+
+#pragma once
+
+#include <cstddef>
+
+#include "SHA256.h"
+
+const unsigned long long PBKDF2_MAX_BLOCKS_COUNT = 0xffffffffULL;
+
+bool pbkdf2(
+	const void* password, size_t passwordSize,
+	const void* salt, size_t saltSize,
+	unsigned int iterations,
+	unsigned char* output, size_t outputSize);
+bool pbkdf2Many(
+	const MessageSpan* passwords, const MessageSpan* salts, size_t count,
+	unsigned int iterations,
+	unsigned char* outputs, size_t outputSize);
\ No newline at end of file
@@ -0,0 +1,290 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the read pipeline, which overlaps reading a file with hashing it
+* A reader thread fills a ring of aligned buffers while the calling thread hashes the filled ones in order,
+* so a file is hashed at the speed of the slower of the disk and the processor instead of their sum
+* Every hashing thread keeps its ring and its reader thread for all of its files, and the first buffer of bytes
+* of a file is read by the hashing thread itself, so small files don't wait on the reader thread
+* Those first reads start small and double, as a direct read costs as much as the size it asks for, even past the end
+*
+*/
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "Metrics.h"
+#include "ReadPipeline.h"
+
+using namespace std;
+
+// A buffer of the ring - a filled buffer with a size of zero or less is the last one
+struct PipelineBuffer
+{
+	unsigned char* bytes;
+	long long size;
+	bool isFilled;
+};
+
+// The source that is being read and how much of it is left
+struct PipelineJob
+{
+	SequentialReader reader;
+	void* source;
+	unsigned long long maxBytes;
+	size_t requestAlignment;
+};
+
+// The ring of buffers shared between the reader thread and the hashing thread
+// The reader thread waits for a job between the files and stops when the hashing thread exits
+struct ReadPipeline
+{
+	unsigned char* memory;
+	PipelineBuffer buffers[PIPELINE_BUFFERS_COUNT];
+	mutex buffersMutex;
+	condition_variable buffersChanged;
+
+	PipelineJob job;
+	bool hasJob;
+	bool isStopping;
+	thread readerThread;
+
+	ReadPipeline();
+	~ReadPipeline();
+};
+
+// Rounds a size up to a multiple of the alignment
+size_t alignSize(size_t size, size_t alignment)
+{
+	return (size + alignment - 1) / alignment * alignment;
+}
+
+// Reads up to the given amount of the next bytes of a job into a buffer
+// Never asks for more than the bytes left rounded up to the request alignment, so a pipe isn't read beyond what is hashed
+// Returns the count of read bytes that are within the limit, zero at the end or -1 if the reading fails
+long long readJobBytes(const PipelineJob& job, unsigned long long bytesRead, size_t maxRequestBytes, unsigned char* buffer)
+{
+	unsigned long long bytesLeft = job.maxBytes - bytesRead;
+	if (bytesLeft == 0)
+	{
+		return 0;
+	}
+
+	size_t requestBytes = bytesLeft < maxRequestBytes ? (size_t)bytesLeft : maxRequestBytes;
+	METRICS_START(readStart);
+	long long size = job.reader(job.source, buffer, alignSize(requestBytes, job.requestAlignment));
+	METRICS_STOP(STAGE_READ, readStart);
+
+	if (size > 0 && (unsigned long long)size > bytesLeft)
+	{
+		size = (long long)bytesLeft;
+	}
+	if (size > 0)
+	{
+		METRICS_COUNT(COUNTER_BYTES_READ, (unsigned long long)size);
+	}
+
+	return size;
+}
+
+// Marks a buffer as filled with the given amount of bytes or as empty and wakes the other thread
+void setBufferFilled(ReadPipeline& pipeline, PipelineBuffer& buffer, long long size, bool isFilled)
+{
+	{
+		lock_guard<mutex> lock(pipeline.buffersMutex);
+		buffer.size = size;
+		buffer.isFilled = isFilled;
+	}
+	pipeline.buffersChanged.notify_all();
+}
+
+// Fills the buffers in order until the end of the source, a failure or the byte limit
+void readJobBuffers(ReadPipeline& pipeline)
+{
+	unsigned long long bytesRead = 0;
+	for (size_t index = 0; true; index = (index + 1) % PIPELINE_BUFFERS_COUNT)
+	{
+		PipelineBuffer& buffer = pipeline.buffers[index];
+		{
+			unique_lock<mutex> lock(pipeline.buffersMutex);
+			pipeline.buffersChanged.wait(lock, [&buffer]() { return !buffer.isFilled; });
+		}
+
+		long long size = readJobBytes(pipeline.job, bytesRead, PIPELINE_BUFFER_BYTES, buffer.bytes);
+		setBufferFilled(pipeline, buffer, size, true);
+		if (size <= 0)
+		{
+			return;
+		}
+
+		bytesRead += (unsigned long long)size;
+	}
+}
+
+// Reads the jobs of the hashing thread one after another until the pipeline is stopped
+void readPipelineWorker(ReadPipeline& pipeline)
+{
+	while (true)
+	{
+		{
+			unique_lock<mutex> lock(pipeline.buffersMutex);
+			pipeline.buffersChanged.wait(lock, [&pipeline]() { return pipeline.hasJob || pipeline.isStopping; });
+			if (pipeline.isStopping)
+			{
+				return;
+			}
+		}
+
+		readJobBuffers(pipeline);
+
+		{
+			lock_guard<mutex> lock(pipeline.buffersMutex);
+			pipeline.hasJob = false;
+		}
+		pipeline.buffersChanged.notify_all();
+	}
+}
+
+// Allocates the aligned buffers of a ring, the reader thread is only started by the first file that needs it
+ReadPipeline::ReadPipeline()
+{
+	memory = new unsigned char[PIPELINE_BUFFERS_COUNT * PIPELINE_BUFFER_BYTES + PIPELINE_BUFFER_ALIGNMENT];
+	size_t misalignment = (size_t)memory % PIPELINE_BUFFER_ALIGNMENT;
+	unsigned char* alignedMemory = misalignment == 0 ? memory : memory + (PIPELINE_BUFFER_ALIGNMENT - misalignment);
+
+	for (size_t i = 0; i < PIPELINE_BUFFERS_COUNT; i++)
+	{
+		buffers[i].bytes = alignedMemory + i * PIPELINE_BUFFER_BYTES;
+		buffers[i].size = 0;
+		buffers[i].isFilled = false;
+	}
+
+	hasJob = false;
+	isStopping = false;
+}
+
+// Stops the reader thread, which is waiting for a job, and frees the buffers
+ReadPipeline::~ReadPipeline()
+{
+	if (readerThread.joinable())
+	{
+		{
+			lock_guard<mutex> lock(buffersMutex);
+			isStopping = true;
+		}
+		buffersChanged.notify_all();
+		readerThread.join();
+	}
+
+	delete[] memory;
+}
+
+// Returns the pipeline of the calling thread, which is created on its first file and kept until the thread exits
+ReadPipeline& getThreadPipeline()
+{
+	thread_local ReadPipeline pipeline;
+
+	return pipeline;
+}
+
+// Hands the rest of a source to the reader thread and hashes the buffers it fills until the last one
+// Returns false if the reading fails
+bool hashJobBuffers(ReadPipeline& pipeline, ContextUpdater updater, void* context)
+{
+	{
+		lock_guard<mutex> lock(pipeline.buffersMutex);
+		for (PipelineBuffer& buffer : pipeline.buffers)
+		{
+			buffer.isFilled = false;
+		}
+		pipeline.hasJob = true;
+	}
+
+	if (!pipeline.readerThread.joinable())
+	{
+		pipeline.readerThread = thread(readPipelineWorker, ref(pipeline));
+	}
+	pipeline.buffersChanged.notify_all();
+
+	bool success = true;
+	for (size_t index = 0; true; index = (index + 1) % PIPELINE_BUFFERS_COUNT)
+	{
+		PipelineBuffer& buffer = pipeline.buffers[index];
+		long long size = 0;
+		{
+			unique_lock<mutex> lock(pipeline.buffersMutex);
+			pipeline.buffersChanged.wait(lock, [&buffer]() { return buffer.isFilled; });
+			size = buffer.size;
+		}
+
+		if (size <= 0)
+		{
+			success = size == 0;
+			break;
+		}
+
+		updater(context, buffer.bytes, (size_t)size);
+		setBufferFilled(pipeline, buffer, 0, false);
+	}
+
+	unique_lock<mutex> lock(pipeline.buffersMutex);
+	pipeline.buffersChanged.wait(lock, [&pipeline]() { return !pipeline.hasJob; });
+
+	return success;
+}
+
+// Hashes up to the given amount of bytes of a source, which is read by a separate thread into PIPELINE_BUFFERS_COUNT buffers
+// The bytes are fed to the context through the given updater, so any hash function can be used
+// The first PIPELINE_BUFFER_BYTES are read by the calling thread in growing requests, so a small file is hashed
+// without a thread handoff and with a single small read before its end
+// Every read asks for a multiple of the request alignment, as direct I/O needs, and the buffers are aligned for it too
+// Returns false if the reading fails
+bool hashPipelined(
+	SequentialReader reader, void* source, unsigned long long maxBytes, size_t requestAlignment,
+	ContextUpdater updater, void* context)
+{
+	if (requestAlignment == 0 || PIPELINE_BUFFER_BYTES % requestAlignment != 0 || PIPELINE_BUFFER_ALIGNMENT % requestAlignment != 0)
+	{
+		return false;
+	}
+
+	ReadPipeline& pipeline = getThreadPipeline();
+	PipelineJob job = { reader, source, maxBytes, requestAlignment };
+
+	unsigned long long bytesRead = 0;
+	size_t requestBytes = PIPELINE_FIRST_REQUEST_BYTES;
+	while (true)
+	{
+		long long size = readJobBytes(job, bytesRead, requestBytes, pipeline.buffers[0].bytes);
+		if (size <= 0)
+		{
+			return size == 0;
+		}
+
+		updater(context, pipeline.buffers[0].bytes, (size_t)size);
+		bytesRead += (unsigned long long)size;
+
+		if (bytesRead >= PIPELINE_BUFFER_BYTES)
+		{
+			break;
+		}
+
+		if (2 * requestBytes <= PIPELINE_BUFFER_BYTES)
+		{
+			requestBytes *= 2;
+		}
+	}
+
+	pipeline.job = job;
+	pipeline.job.maxBytes = maxBytes - bytesRead;
+	return hashJobBuffers(pipeline, updater, context);
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the declaration of the read pipeline, which overlaps reading a file with hashing it
+*
+*/
+
+#pragma once
+
+#include <cstddef>
+
+const size_t PIPELINE_BUFFERS_COUNT = 4;
+const size_t PIPELINE_BUFFER_BYTES = 4 << 20;
+const size_t PIPELINE_BUFFER_ALIGNMENT = 4096;
+const size_t PIPELINE_FIRST_REQUEST_BYTES = 64 << 10;
+
+// Reads the next bytes of a source into a buffer
+// Returns the count of read bytes, zero at the end of the source or -1 if the reading fails
+typedef long long (*SequentialReader)(void* source, void* buffer, size_t size);
+
+// Feeds the next bytes of a message to the context of an incremental hashing operation of some hash function
+typedef void (*ContextUpdater)(void* context, const void* data, size_t size);
+
+bool hashPipelined(
+	SequentialReader reader, void* source, unsigned long long maxBytes, size_t requestAlignment,
+	ContextUpdater updater, void* context);
\ No newline at end of file
@@ -15,4 +15,54 @@
 
 #pragma once
 
-char* hashMessage(const char* initialMessage);
\ No newline at end of file
+#include <cstddef>
+
+const size_t CONTEXT_STATE_WORDS = 8;
+const size_t CONTEXT_BLOCK_BYTES = 64;
+const size_t DIGEST_BYTES = 32;
+const size_t DIGEST_TEXT_SIZE = 2 * DIGEST_BYTES + 1;
+const size_t SERIALIZED_CONTEXT_BYTES = DIGEST_BYTES + sizeof(unsigned long long) + CONTEXT_BLOCK_BYTES;
+
+// The state of an incremental hashing operation
+// Holds the state registers and at most one not yet hashed message block
+struct Sha256Context
+{
+	unsigned int state[CONTEXT_STATE_WORDS];
+	unsigned char buffer[CONTEXT_BLOCK_BYTES];
+	size_t bufferedBytes;
+	unsigned long long totalBytes;
+};
+
+// A view of one message of a batch
+struct MessageSpan
+{
+	const void* data;
+	size_t size;
+};
+
+// The raw bytes of a hash result
+struct Digest
+{
+	unsigned char bytes[DIGEST_BYTES];
+};
+
+void initContext(Sha256Context& context);
+void updateContext(Sha256Context& context, const void* data, size_t size);
+void finalContextDigest(Sha256Context& context, Digest& digest);
+char* finalContext(Sha256Context& context);
+
+void serializeContext(const Sha256Context& context, unsigned char* bytes);
+bool deserializeContext(const unsigned char* bytes, size_t size, Sha256Context& context);
+void hashSuffixDigest(const Sha256Context& prefix, const void* suffix, size_t size, Digest& digest);
+
+void formatHex(const unsigned char* bytes, size_t size, char* text);
+void formatDigest(const Digest& digest, char* text);
+char* getDigestText(const Digest& digest);
+bool parseHex(const char* text, size_t size, unsigned char* bytes);
+bool parseDigest(const char* text, size_t size, Digest& digest);
+
+void hashBytesDigest(const unsigned char* bytes, size_t size, Digest& digest);
+char* hashBytes(const unsigned char* bytes, unsigned long long size);
+char* hashMessage(const char* initialMessage);
+void hashMany(const MessageSpan* inputs, size_t count, Digest* results);
+void hashManySuffixes(const Sha256Context& prefix, const MessageSpan* inputs, size_t count, Digest* results);
\ No newline at end of file
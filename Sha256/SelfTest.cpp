@@ -0,0 +1,147 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the quick self-test
+* The heap allocations are only checked when they are counted - in builds with SHA256_COUNT_ALLOCATIONS
+*
+*/
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "AllocationCounter.h"
+#include "SelfTest.h"
+#include "SHA256.h"
+#include "Sha256Kernels.h"
+
+using namespace std;
+
+// How many times each allocation-free operation is called while its allocations are counted
+const size_t ALLOCATION_CHECK_CALLS = 100;
+
+// The message sizes hashed by the allocation check - around the padding boundaries and up to many blocks
+const size_t ALLOCATION_CHECK_SIZES[] = { 0, 55, 56, 64, 1 << 10, 64 << 10, 1 << 20 };
+
+// A message and its SHA256 digest from FIPS 180-4 and its examples
+struct KnownAnswer
+{
+	const char* message;
+	const char* digest;
+};
+
+const KnownAnswer KNOWN_ANSWERS[] =
+{
+	{ "", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" },
+	{ "abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+	{ "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" }
+};
+
+// Prints the outcome of a check
+// Returns whether the check has passed
+bool reportCheck(const char* name, bool isPassed)
+{
+	cout << (isPassed ? "ok      " : "FAILED  ") << name << endl;
+	return isPassed;
+}
+
+// Calls an operation a fixed amount of times and counts the heap allocations it makes
+template <typename Operation>
+unsigned long long countAllocations(Operation operation)
+{
+	unsigned long long startAllocations = getAllocationsCount();
+	for (size_t i = 0; i < ALLOCATION_CHECK_CALLS; i++)
+	{
+		operation();
+	}
+
+	return getAllocationsCount() - startAllocations;
+}
+
+// Checks the digests of the known messages
+bool checkKnownAnswers()
+{
+	bool success = true;
+	for (const KnownAnswer& answer : KNOWN_ANSWERS)
+	{
+		Digest digest;
+		hashBytesDigest((const unsigned char*)answer.message, strlen(answer.message), digest);
+
+		char text[DIGEST_TEXT_SIZE];
+		formatDigest(digest, text);
+
+		Digest parsedDigest;
+		bool isParsed = parseDigest(answer.digest, strlen(answer.digest), parsedDigest);
+
+		bool isPassed = strcmp(text, answer.digest) == 0 && isParsed && areDigestsEqual(digest, parsedDigest);
+		success = isPassed && success;
+	}
+
+	return reportCheck("known digests", success);
+}
+
+// Checks that a tail which leaves no room for the message length gets a second final block
+bool checkFinalBlocks()
+{
+	unsigned char tail[MESSAGE_BLOCK_BYTES] = { 0 };
+	unsigned char finalBlocks[FINAL_BLOCKS_MAX_BYTES];
+
+	bool isPassed = createFinalBlocks(tail, 55, 55, finalBlocks) == 1 &&
+		createFinalBlocks(tail, 56, 56, finalBlocks) == 2 &&
+		finalBlocks[56] == 0x80;
+
+	return reportCheck("final blocks", isPassed);
+}
+
+// Checks that the hashing, padding and formatting functions don't allocate, with the operator new of the counter
+bool checkAllocationFree()
+{
+	if (!ARE_ALLOCATIONS_COUNTED)
+	{
+		cout << "skipped allocation checks - they need a build with SHA256_COUNT_ALLOCATIONS" << endl;
+		return true;
+	}
+
+	vector<unsigned char> message(ALLOCATION_CHECK_SIZES[sizeof(ALLOCATION_CHECK_SIZES) / sizeof(ALLOCATION_CHECK_SIZES[0]) - 1], 'a');
+	unsigned char finalBlocks[FINAL_BLOCKS_MAX_BYTES];
+	Digest digest = {};
+	char text[DIGEST_TEXT_SIZE];
+	formatDigest(digest, text);
+
+	unsigned long long hashingAllocations = 0;
+	for (size_t size : ALLOCATION_CHECK_SIZES)
+	{
+		hashingAllocations += countAllocations([&]() { hashBytesDigest(message.data(), size, digest); });
+	}
+
+	bool success = reportCheck("hashBytesDigest doesn't allocate", hashingAllocations == 0);
+	success = reportCheck("createFinalBlocks doesn't allocate",
+		countAllocations([&]() { createFinalBlocks(message.data(), 55, 55, finalBlocks); }) == 0 &&
+		countAllocations([&]() { createFinalBlocks(message.data(), 63, 63, finalBlocks); }) == 0) && success;
+	success = reportCheck("formatDigest doesn't allocate",
+		countAllocations([&]() { formatDigest(digest, text); }) == 0) && success;
+	success = reportCheck("parseDigest doesn't allocate",
+		countAllocations([&]() { parseDigest(text, 2 * DIGEST_BYTES, digest); }) == 0) && success;
+
+	return success;
+}
+
+// Runs every check of the self-test and prints their outcomes
+// Returns the process exit code - zero if every check has passed
+int runSelfTest()
+{
+	bool success = checkKnownAnswers();
+	success = checkFinalBlocks() && success;
+	success = checkAllocationFree() && success;
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
\ No newline at end of file
@@ -0,0 +1,19 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the declaration of the quick self-test
+* It checks known digests and that the hashing, padding and formatting functions never allocate on the heap
+*
+*/
+
+#pragma once
+
+int runSelfTest();
\ No newline at end of file
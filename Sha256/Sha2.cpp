@@ -0,0 +1,172 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the compiled kernel of the SHA-2 variants over 64 bit words
+* and the selection of a variant by its name at run time
+*
+*/
+
+#include <cctype>
+#include <cstring>
+#include <string>
+
+#include "Metrics.h"
+#include "Sha2.h"
+
+using namespace std;
+
+// The names of the variants, in the order of Sha2Algorithm
+const char* SHA2_ALGORITHM_NAMES[] = { "sha224", "sha256", "sha384", "sha512", "sha512-256" };
+const size_t SHA2_ALGORITHMS_COUNT = sizeof(SHA2_ALGORITHM_NAMES) / sizeof(SHA2_ALGORITHM_NAMES[0]);
+
+// Hashes a sequence of full 128 byte message blocks into the eight 64 bit state registers
+// The SHA-2 engine specialized for 64 bit words, shared by SHA-384, SHA-512 and SHA-512/256
+void hashSha512Blocks(const unsigned char* messageBlocks, size_t blocksCount, unsigned long long* resultHash)
+{
+	hashSha2BlocksFast(messageBlocks, blocksCount, resultHash);
+}
+
+// Finds a variant by its name in either case, as in "sha512-256", "sha512/256" or the FIPS 180-4 "SHA-512/256"
+// Returns false if there is no variant with that name
+bool parseSha2Algorithm(const char* name, Sha2Algorithm& algorithm)
+{
+	const size_t PREFIX_SIZE = 3;
+
+	string normalizedName;
+	for (const char* symbol = name; *symbol != '\0'; symbol++)
+	{
+		char lowerSymbol = (char)tolower((unsigned char)*symbol);
+		if (lowerSymbol == '-' && normalizedName.size() == PREFIX_SIZE)
+		{
+			continue;
+		}
+
+		normalizedName += lowerSymbol == '/' ? '-' : lowerSymbol;
+	}
+
+	for (size_t i = 0; i < SHA2_ALGORITHMS_COUNT; i++)
+	{
+		if (normalizedName == SHA2_ALGORITHM_NAMES[i])
+		{
+			algorithm = (Sha2Algorithm)i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Returns the name of a variant
+const char* getSha2AlgorithmName(Sha2Algorithm algorithm)
+{
+	return SHA2_ALGORITHM_NAMES[algorithm];
+}
+
+// Returns the size of the hash result of a variant in bytes
+size_t getSha2ResultBytes(Sha2Algorithm algorithm)
+{
+	switch (algorithm)
+	{
+	case SHA2_224:
+		return Sha224Variant::RESULT_BYTES;
+	case SHA2_256:
+		return Sha256Variant::RESULT_BYTES;
+	case SHA2_384:
+		return Sha384Variant::RESULT_BYTES;
+	case SHA2_512:
+		return Sha512Variant::RESULT_BYTES;
+	default:
+		return Sha512_256Variant::RESULT_BYTES;
+	}
+}
+
+// Hashes a whole message with a variant into a caller-provided result of getSha2ResultBytes bytes
+template <typename Variant>
+void hashVariantBytes(const void* data, size_t size, unsigned char* result)
+{
+	Sha2Digest<Variant> digest;
+	hashSha2Digest(data, size, digest);
+	memcpy(result, digest.bytes, Variant::RESULT_BYTES);
+}
+
+// Hashes a whole message with the variant chosen at run time
+// The result must have space for getSha2ResultBytes bytes of the variant
+void hashSha2Bytes(Sha2Algorithm algorithm, const void* data, size_t size, unsigned char* result)
+{
+	switch (algorithm)
+	{
+	case SHA2_224:
+		hashVariantBytes<Sha224Variant>(data, size, result);
+		break;
+	case SHA2_256:
+		hashVariantBytes<Sha256Variant>(data, size, result);
+		break;
+	case SHA2_384:
+		hashVariantBytes<Sha384Variant>(data, size, result);
+		break;
+	case SHA2_512:
+		hashVariantBytes<Sha512Variant>(data, size, result);
+		break;
+	default:
+		hashVariantBytes<Sha512_256Variant>(data, size, result);
+		break;
+	}
+}
+
+// Feeds message bytes to the context of a variant
+template <typename Variant>
+void updateVariantContext(void* context, const void* data, size_t size)
+{
+	updateSha2Context(*static_cast<Sha2Context<Variant>*>(context), data, size);
+}
+
+// Hashes up to the given amount of bytes of a file with a variant into a caller-provided result of getSha2ResultBytes bytes
+// Returns false if the file can't be read
+template <typename Variant>
+bool hashVariantFile(FileFeedFunction feedFunction, const char* path, unsigned long long maxBytes, unsigned char* result)
+{
+	METRICS_FILE_START(fileStart);
+
+	Sha2Context<Variant> context;
+	initSha2Context(context);
+
+	if (!feedFunction(path, maxBytes, updateVariantContext<Variant>, &context))
+	{
+		return false;
+	}
+
+	Sha2Digest<Variant> digest;
+	finalSha2ContextDigest(context, digest);
+	memcpy(result, digest.bytes, Variant::RESULT_BYTES);
+
+	METRICS_FILE_STOP(fileStart);
+	return true;
+}
+
+// Hashes up to the given amount of bytes of a file, read with the given function, with the variant chosen at run time
+// The result must have space for getSha2ResultBytes bytes of the variant
+// Returns false if the file can't be read
+bool hashSha2File(Sha2Algorithm algorithm, FileFeedFunction feedFunction, const char* path, unsigned long long maxBytes, unsigned char* result)
+{
+	switch (algorithm)
+	{
+	case SHA2_224:
+		return hashVariantFile<Sha224Variant>(feedFunction, path, maxBytes, result);
+	case SHA2_256:
+		return hashVariantFile<Sha256Variant>(feedFunction, path, maxBytes, result);
+	case SHA2_384:
+		return hashVariantFile<Sha384Variant>(feedFunction, path, maxBytes, result);
+	case SHA2_512:
+		return hashVariantFile<Sha512Variant>(feedFunction, path, maxBytes, result);
+	default:
+		return hashVariantFile<Sha512_256Variant>(feedFunction, path, maxBytes, result);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,552 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the SHA-2 family (SHA-224, SHA-256, SHA-384, SHA-512 and SHA-512/256) as templates
+* over the word type, so every variant is a compile-time specialization of the same engine
+* The variants over 32 bit words compress with the kernel selected for SHA256 and hash batches over its lanes
+*
+*/
+
+#pragma once
+
+#include <cstddef>
+
+#ifdef _MSC_VER
+#include <stdlib.h>
+#endif
+
+#include "FileHashing.h"
+#include "SHA256.h"
+#include "Sha256Constexpr.h"
+#include "Sha256Kernels.h"
+
+constexpr size_t SHA2_STATE_WORDS = 8;
+constexpr size_t SHA2_BLOCK_WORDS = 16;
+constexpr size_t SHA2_LENGTH_WORDS = 2;
+constexpr size_t SHA2_BATCH_CHUNK = 64;
+
+// The K-constants of the SHA-2 variants over 64 bit words
+constexpr unsigned long long SHA512_CONSTANTS[80] =
+{
+	0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+	0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+	0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+	0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+	0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+	0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+	0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+	0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+	0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+	0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+	0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+	0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+	0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+	0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+	0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+	0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+	0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+	0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+	0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+	0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+};
+
+// The initial state registers of SHA-224
+constexpr unsigned int SHA224_INITIAL_VALUES[SHA2_STATE_WORDS] =
+{
+	0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939,
+	0xffc00b31, 0x68581511, 0x64f98fa7, 0xbefa4fa4
+};
+
+// The initial state registers of SHA-384
+constexpr unsigned long long SHA384_INITIAL_VALUES[SHA2_STATE_WORDS] =
+{
+	0xcbbb9d5dc1059ed8ULL, 0x629a292a367cd507ULL, 0x9159015a3070dd17ULL, 0x152fecd8f70e5939ULL,
+	0x67332667ffc00b31ULL, 0x8eb44a8768581511ULL, 0xdb0c2e0d64f98fa7ULL, 0x47b5481dbefa4fa4ULL
+};
+
+// The initial state registers of SHA-512
+constexpr unsigned long long SHA512_INITIAL_VALUES[SHA2_STATE_WORDS] =
+{
+	0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+	0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+// The initial state registers of SHA-512/256, generated from the name of the variant as FIPS 180-4 describes
+constexpr unsigned long long SHA512_256_INITIAL_VALUES[SHA2_STATE_WORDS] =
+{
+	0x22312194fc2bf72cULL, 0x9f555fa3c84c64c2ULL, 0x2393b86b6f53b151ULL, 0x963877195940eabdULL,
+	0x96283ee2a88effe3ULL, 0xbe5e1e2553863992ULL, 0x2b0199fc2c85b8aaULL, 0x0eb72ddc81c52ca2ULL
+};
+
+/*
+	Word parameters and variants
+*/
+
+// The rounds count, the K-constants and the rotation and shift amounts of the SHA-2 functions over one word type
+template <typename Word>
+struct Sha2WordParameters;
+
+template <>
+struct Sha2WordParameters<unsigned int>
+{
+	static constexpr size_t ROUNDS_COUNT = 64;
+	static constexpr const unsigned int* CONSTANTS = CUBE_ROOT_CONSTANTS;
+
+	static constexpr unsigned int UPPER_SIGMA_ZERO_FIRST = 2;
+	static constexpr unsigned int UPPER_SIGMA_ZERO_SECOND = 13;
+	static constexpr unsigned int UPPER_SIGMA_ZERO_THIRD = 22;
+	static constexpr unsigned int UPPER_SIGMA_ONE_FIRST = 6;
+	static constexpr unsigned int UPPER_SIGMA_ONE_SECOND = 11;
+	static constexpr unsigned int UPPER_SIGMA_ONE_THIRD = 25;
+	static constexpr unsigned int LOWER_SIGMA_ZERO_FIRST = 7;
+	static constexpr unsigned int LOWER_SIGMA_ZERO_SECOND = 18;
+	static constexpr unsigned int LOWER_SIGMA_ZERO_SHIFT = 3;
+	static constexpr unsigned int LOWER_SIGMA_ONE_FIRST = 17;
+	static constexpr unsigned int LOWER_SIGMA_ONE_SECOND = 19;
+	static constexpr unsigned int LOWER_SIGMA_ONE_SHIFT = 10;
+};
+
+template <>
+struct Sha2WordParameters<unsigned long long>
+{
+	static constexpr size_t ROUNDS_COUNT = 80;
+	static constexpr const unsigned long long* CONSTANTS = SHA512_CONSTANTS;
+
+	static constexpr unsigned int UPPER_SIGMA_ZERO_FIRST = 28;
+	static constexpr unsigned int UPPER_SIGMA_ZERO_SECOND = 34;
+	static constexpr unsigned int UPPER_SIGMA_ZERO_THIRD = 39;
+	static constexpr unsigned int UPPER_SIGMA_ONE_FIRST = 14;
+	static constexpr unsigned int UPPER_SIGMA_ONE_SECOND = 18;
+	static constexpr unsigned int UPPER_SIGMA_ONE_THIRD = 41;
+	static constexpr unsigned int LOWER_SIGMA_ZERO_FIRST = 1;
+	static constexpr unsigned int LOWER_SIGMA_ZERO_SECOND = 8;
+	static constexpr unsigned int LOWER_SIGMA_ZERO_SHIFT = 7;
+	static constexpr unsigned int LOWER_SIGMA_ONE_FIRST = 19;
+	static constexpr unsigned int LOWER_SIGMA_ONE_SECOND = 61;
+	static constexpr unsigned int LOWER_SIGMA_ONE_SHIFT = 6;
+};
+
+// SHA-224 - the SHA256 compression with other initial values and the result truncated to 28 bytes
+struct Sha224Variant
+{
+	typedef unsigned int Word;
+	static constexpr size_t RESULT_BYTES = 28;
+	static constexpr const Word* INITIAL_VALUES = SHA224_INITIAL_VALUES;
+};
+
+// SHA256 through the templated interface
+struct Sha256Variant
+{
+	typedef unsigned int Word;
+	static constexpr size_t RESULT_BYTES = 32;
+	static constexpr const Word* INITIAL_VALUES = INITIAL_HASH_VALUES;
+};
+
+// SHA-384 - the SHA-512 compression with other initial values and the result truncated to 48 bytes
+struct Sha384Variant
+{
+	typedef unsigned long long Word;
+	static constexpr size_t RESULT_BYTES = 48;
+	static constexpr const Word* INITIAL_VALUES = SHA384_INITIAL_VALUES;
+};
+
+// SHA-512
+struct Sha512Variant
+{
+	typedef unsigned long long Word;
+	static constexpr size_t RESULT_BYTES = 64;
+	static constexpr const Word* INITIAL_VALUES = SHA512_INITIAL_VALUES;
+};
+
+// SHA-512/256 - the SHA-512 compression with other initial values and the result truncated to 32 bytes
+// Without SHA-NI it is faster per byte than SHA256 on 64 bit processors, as it hashes 128 bytes in 80 rounds
+struct Sha512_256Variant
+{
+	typedef unsigned long long Word;
+	static constexpr size_t RESULT_BYTES = 32;
+	static constexpr const Word* INITIAL_VALUES = SHA512_256_INITIAL_VALUES;
+};
+
+// The state of an incremental hashing operation of a variant
+// Holds the state registers and at most one not yet hashed message block
+template <typename Variant>
+struct Sha2Context
+{
+	typename Variant::Word state[SHA2_STATE_WORDS];
+	unsigned char buffer[SHA2_BLOCK_WORDS * sizeof(typename Variant::Word)];
+	size_t bufferedBytes;
+	unsigned long long totalBytes;
+};
+
+// The raw bytes of a hash result of a variant
+template <typename Variant>
+struct Sha2Digest
+{
+	unsigned char bytes[Variant::RESULT_BYTES];
+};
+
+void hashSha512Blocks(const unsigned char* messageBlocks, size_t blocksCount, unsigned long long* resultHash);
+
+/*
+	Block compression
+	The round functions are written once for both word types and take their amounts from the word parameters
+*/
+
+// Performs a bitwise right rotation on a 32 bit word with a native rotate instruction
+// The positions must be in the range [1, 31]
+inline unsigned int rotateSha2Word(unsigned int word, unsigned int positions)
+{
+#ifdef _MSC_VER
+	return _rotr(word, positions);
+#else
+	return (word >> positions) | (word << (32 - positions));
+#endif
+}
+
+// Performs a bitwise right rotation on a 64 bit word with a native rotate instruction
+// The positions must be in the range [1, 63]
+inline unsigned long long rotateSha2Word(unsigned long long word, unsigned int positions)
+{
+#ifdef _MSC_VER
+	return _rotr64(word, positions);
+#else
+	return (word >> positions) | (word << (64 - positions));
+#endif
+}
+
+// Reads a big-endian word from its bytes
+template <typename Word>
+inline Word loadSha2Word(const unsigned char* bytes)
+{
+	Word word = 0;
+	for (size_t i = 0; i < sizeof(Word); i++)
+	{
+		word = (word << BYTE_SIZE) | bytes[i];
+	}
+
+	return word;
+}
+
+// Generates the next message schedule word in a circular schedule of 16 words
+template <typename Word>
+inline Word expandSha2Schedule(Word* schedule, size_t index)
+{
+	typedef Sha2WordParameters<Word> Parameters;
+
+	Word secondToLast = schedule[(index - 2) & 15];
+	Word fifteenthToLast = schedule[(index - 15) & 15];
+
+	Word lowerSigmaOneValue =
+		rotateSha2Word(secondToLast, Parameters::LOWER_SIGMA_ONE_FIRST) ^
+		rotateSha2Word(secondToLast, Parameters::LOWER_SIGMA_ONE_SECOND) ^
+		(secondToLast >> Parameters::LOWER_SIGMA_ONE_SHIFT);
+	Word lowerSigmaZeroValue =
+		rotateSha2Word(fifteenthToLast, Parameters::LOWER_SIGMA_ZERO_FIRST) ^
+		rotateSha2Word(fifteenthToLast, Parameters::LOWER_SIGMA_ZERO_SECOND) ^
+		(fifteenthToLast >> Parameters::LOWER_SIGMA_ZERO_SHIFT);
+
+	schedule[index & 15] += lowerSigmaOneValue + schedule[(index - 7) & 15] + lowerSigmaZeroValue;
+	return schedule[index & 15];
+}
+
+// Performs a single round on the state registers
+// Instead of moving the registers, the callers rotate the argument names, so only d and h are written
+template <typename Word>
+inline void hashSha2Round(
+	Word a, Word b, Word c, Word& d,
+	Word e, Word f, Word g, Word& h,
+	Word constantWord, Word messageWord)
+{
+	typedef Sha2WordParameters<Word> Parameters;
+
+	Word firstTempWord = h +
+		(rotateSha2Word(e, Parameters::UPPER_SIGMA_ONE_FIRST) ^
+			rotateSha2Word(e, Parameters::UPPER_SIGMA_ONE_SECOND) ^
+			rotateSha2Word(e, Parameters::UPPER_SIGMA_ONE_THIRD)) +
+		(g ^ (e & (f ^ g))) +
+		constantWord +
+		messageWord;
+
+	Word secondTempWord =
+		(rotateSha2Word(a, Parameters::UPPER_SIGMA_ZERO_FIRST) ^
+			rotateSha2Word(a, Parameters::UPPER_SIGMA_ZERO_SECOND) ^
+			rotateSha2Word(a, Parameters::UPPER_SIGMA_ZERO_THIRD)) +
+		((a & b) | (c & (a | b)));
+
+	d += firstTempWord;
+	h = firstTempWord + secondTempWord;
+}
+
+// Hashes a sequence of full message blocks of 16 words each without any validation
+// The message schedule is generated alongside the rounds instead of being prepared in advance
+template <typename Word>
+void hashSha2BlocksFast(const unsigned char* messageBlocks, size_t blocksCount, Word* resultHash)
+{
+	typedef Sha2WordParameters<Word> Parameters;
+
+	for (size_t block = 0; block < blocksCount; block++)
+	{
+		const unsigned char* messageBlock = messageBlocks + block * SHA2_BLOCK_WORDS * sizeof(Word);
+
+		Word schedule[SHA2_BLOCK_WORDS];
+		for (size_t i = 0; i < SHA2_BLOCK_WORDS; i++)
+		{
+			schedule[i] = loadSha2Word<Word>(messageBlock + i * sizeof(Word));
+		}
+
+		Word a = resultHash[0], b = resultHash[1], c = resultHash[2], d = resultHash[3];
+		Word e = resultHash[4], f = resultHash[5], g = resultHash[6], h = resultHash[7];
+
+		const Word* k = Parameters::CONSTANTS;
+		for (size_t i = 0; i < SHA2_BLOCK_WORDS; i += 8)
+		{
+			hashSha2Round(a, b, c, d, e, f, g, h, k[i + 0], schedule[i + 0]);
+			hashSha2Round(h, a, b, c, d, e, f, g, k[i + 1], schedule[i + 1]);
+			hashSha2Round(g, h, a, b, c, d, e, f, k[i + 2], schedule[i + 2]);
+			hashSha2Round(f, g, h, a, b, c, d, e, k[i + 3], schedule[i + 3]);
+			hashSha2Round(e, f, g, h, a, b, c, d, k[i + 4], schedule[i + 4]);
+			hashSha2Round(d, e, f, g, h, a, b, c, k[i + 5], schedule[i + 5]);
+			hashSha2Round(c, d, e, f, g, h, a, b, k[i + 6], schedule[i + 6]);
+			hashSha2Round(b, c, d, e, f, g, h, a, k[i + 7], schedule[i + 7]);
+		}
+
+		for (size_t i = SHA2_BLOCK_WORDS; i < Parameters::ROUNDS_COUNT; i += 8)
+		{
+			hashSha2Round(a, b, c, d, e, f, g, h, k[i + 0], expandSha2Schedule(schedule, i + 0));
+			hashSha2Round(h, a, b, c, d, e, f, g, k[i + 1], expandSha2Schedule(schedule, i + 1));
+			hashSha2Round(g, h, a, b, c, d, e, f, k[i + 2], expandSha2Schedule(schedule, i + 2));
+			hashSha2Round(f, g, h, a, b, c, d, e, k[i + 3], expandSha2Schedule(schedule, i + 3));
+			hashSha2Round(e, f, g, h, a, b, c, d, k[i + 4], expandSha2Schedule(schedule, i + 4));
+			hashSha2Round(d, e, f, g, h, a, b, c, k[i + 5], expandSha2Schedule(schedule, i + 5));
+			hashSha2Round(c, d, e, f, g, h, a, b, k[i + 6], expandSha2Schedule(schedule, i + 6));
+			hashSha2Round(b, c, d, e, f, g, h, a, k[i + 7], expandSha2Schedule(schedule, i + 7));
+		}
+
+		resultHash[0] += a;
+		resultHash[1] += b;
+		resultHash[2] += c;
+		resultHash[3] += d;
+		resultHash[4] += e;
+		resultHash[5] += f;
+		resultHash[6] += g;
+		resultHash[7] += h;
+	}
+}
+
+// Hashes full blocks of 32 bit words with the kernel selected for SHA256, so SHA-224 also runs on SHA-NI
+inline void compressSha2Blocks(const unsigned char* messageBlocks, size_t blocksCount, unsigned int* resultHash)
+{
+	hashMessageBlocks(messageBlocks, blocksCount, resultHash);
+}
+
+// Hashes full blocks of 64 bit words
+inline void compressSha2Blocks(const unsigned char* messageBlocks, size_t blocksCount, unsigned long long* resultHash)
+{
+	hashSha512Blocks(messageBlocks, blocksCount, resultHash);
+}
+
+/*
+	Streaming interface
+*/
+
+// Initializes a context for a new incremental hashing operation of a variant
+template <typename Variant>
+void initSha2Context(Sha2Context<Variant>& context)
+{
+	for (size_t i = 0; i < SHA2_STATE_WORDS; i++)
+	{
+		context.state[i] = Variant::INITIAL_VALUES[i];
+	}
+	context.bufferedBytes = 0;
+	context.totalBytes = 0;
+}
+
+// Feeds more message bytes to an incremental hashing operation
+// Whole message blocks are hashed directly from the input, only a partial block is kept in the context
+template <typename Variant>
+void updateSha2Context(Sha2Context<Variant>& context, const void* data, size_t size)
+{
+	const size_t BLOCK_BYTES = sizeof(context.buffer);
+
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	if (bytes == nullptr)
+	{
+		return;
+	}
+
+	context.totalBytes += size;
+
+	if (context.bufferedBytes > 0)
+	{
+		size_t copiedBytes = BLOCK_BYTES - context.bufferedBytes < size ? BLOCK_BYTES - context.bufferedBytes : size;
+		for (size_t i = 0; i < copiedBytes; i++)
+		{
+			context.buffer[context.bufferedBytes + i] = bytes[i];
+		}
+		context.bufferedBytes += copiedBytes;
+		bytes += copiedBytes;
+		size -= copiedBytes;
+
+		if (context.bufferedBytes < BLOCK_BYTES)
+		{
+			return;
+		}
+
+		compressSha2Blocks(context.buffer, 1, context.state);
+		context.bufferedBytes = 0;
+	}
+
+	size_t fullBlocksCount = size / BLOCK_BYTES;
+	compressSha2Blocks(bytes, fullBlocksCount, context.state);
+	bytes += fullBlocksCount * BLOCK_BYTES;
+	size -= fullBlocksCount * BLOCK_BYTES;
+
+	for (size_t i = 0; i < size; i++)
+	{
+		context.buffer[i] = bytes[i];
+	}
+	context.bufferedBytes = size;
+}
+
+// Pads the buffered bytes of the context and hashes the final one or two message blocks
+// The message length takes the last two words of the padding - 8 bytes for the 32 bit variants and 16 for the 64 bit ones
+// Writes the raw bytes of the final hash result and resets the context
+template <typename Variant>
+void finalSha2ContextDigest(Sha2Context<Variant>& context, Sha2Digest<Variant>& digest)
+{
+	typedef typename Variant::Word Word;
+	const size_t BLOCK_BYTES = sizeof(context.buffer);
+	const size_t LENGTH_BYTES = SHA2_LENGTH_WORDS * sizeof(Word);
+
+	unsigned char finalBlocks[2 * BLOCK_BYTES] = { 0 };
+	for (size_t i = 0; i < context.bufferedBytes; i++)
+	{
+		finalBlocks[i] = context.buffer[i];
+	}
+	finalBlocks[context.bufferedBytes] = 0x80;
+
+	size_t finalBytes = context.bufferedBytes + 1 + LENGTH_BYTES <= BLOCK_BYTES ? BLOCK_BYTES : 2 * BLOCK_BYTES;
+	unsigned long long bitsCount = context.totalBytes << 3;
+	for (size_t i = 0; i < sizeof(bitsCount); i++)
+	{
+		finalBlocks[finalBytes - 1 - i] = (unsigned char)(bitsCount >> (i * BYTE_SIZE));
+	}
+	if (LENGTH_BYTES > sizeof(bitsCount))
+	{
+		finalBlocks[finalBytes - 1 - sizeof(bitsCount)] = (unsigned char)(context.totalBytes >> 61);
+	}
+
+	compressSha2Blocks(finalBlocks, finalBytes / BLOCK_BYTES, context.state);
+
+	for (size_t i = 0; i < Variant::RESULT_BYTES; i++)
+	{
+		size_t byteInWord = i % sizeof(Word);
+		digest.bytes[i] = (unsigned char)(context.state[i / sizeof(Word)] >> ((sizeof(Word) - byteInWord - 1) * BYTE_SIZE));
+	}
+
+	initSha2Context(context);
+}
+
+// Hashes a whole message with a variant
+template <typename Variant>
+void hashSha2Digest(const void* data, size_t size, Sha2Digest<Variant>& digest)
+{
+	Sha2Context<Variant> context;
+	initSha2Context(context);
+	updateSha2Context(context, data, size);
+	finalSha2ContextDigest(context, digest);
+}
+
+// Creates a hash text from the bytes of a digest of a variant
+template <typename Variant>
+char* getSha2DigestText(const Sha2Digest<Variant>& digest)
+{
+	char* result = new char[2 * Variant::RESULT_BYTES + 1];
+	formatHex(digest.bytes, Variant::RESULT_BYTES, result);
+
+	return result;
+}
+
+/*
+	Batch interface
+*/
+
+// Hashes a batch of messages one after another, for the variants without multi-buffer lanes
+template <typename Variant, typename Word = typename Variant::Word>
+struct Sha2Batch
+{
+	static void hashMany(const MessageSpan* inputs, size_t count, Sha2Digest<Variant>* results)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			hashSha2Digest(inputs[i].data, inputs[i].size, results[i]);
+		}
+	}
+};
+
+// Hashes a batch of messages of a 32 bit variant over the SHA256 lanes, started from the initial values of the variant
+template <typename Variant>
+struct Sha2Batch<Variant, unsigned int>
+{
+	static void hashMany(const MessageSpan* inputs, size_t count, Sha2Digest<Variant>* results)
+	{
+		Sha256Context prefix;
+		initContext(prefix);
+		for (size_t i = 0; i < SHA2_STATE_WORDS; i++)
+		{
+			prefix.state[i] = Variant::INITIAL_VALUES[i];
+		}
+
+		Digest digests[SHA2_BATCH_CHUNK];
+		for (size_t first = 0; first < count; first += SHA2_BATCH_CHUNK)
+		{
+			size_t chunkCount = count - first < SHA2_BATCH_CHUNK ? count - first : SHA2_BATCH_CHUNK;
+			hashManySuffixes(prefix, inputs + first, chunkCount, digests);
+
+			for (size_t i = 0; i < chunkCount; i++)
+			{
+				for (size_t j = 0; j < Variant::RESULT_BYTES; j++)
+				{
+					results[first + i].bytes[j] = digests[i].bytes[j];
+				}
+			}
+		}
+	}
+};
+
+// Hashes a batch of independent messages with a variant
+template <typename Variant>
+void hashSha2Many(const MessageSpan* inputs, size_t count, Sha2Digest<Variant>* results)
+{
+	Sha2Batch<Variant>::hashMany(inputs, count, results);
+}
+
+/*
+	Selection of a variant at run time
+*/
+
+// The SHA-2 variants that can be chosen by name
+enum Sha2Algorithm
+{
+	SHA2_224,
+	SHA2_256,
+	SHA2_384,
+	SHA2_512,
+	SHA2_512_256
+};
+
+const size_t SHA2_MAX_RESULT_BYTES = 64;
+
+bool parseSha2Algorithm(const char* name, Sha2Algorithm& algorithm);
+const char* getSha2AlgorithmName(Sha2Algorithm algorithm);
+size_t getSha2ResultBytes(Sha2Algorithm algorithm);
+void hashSha2Bytes(Sha2Algorithm algorithm, const void* data, size_t size, unsigned char* result);
+bool hashSha2File(Sha2Algorithm algorithm, FileFeedFunction feedFunction, const char* path, unsigned long long maxBytes, unsigned char* result);
\ No newline at end of file
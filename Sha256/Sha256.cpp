@@ -9,56 +9,74 @@
 * @idnumber 2MI0600203
 * @compiler VC
 *
-* This file contains the logic of the hashing algorithm and all of its constants and settings
+* This file contains the logic of the hashing algorithm
 *
 */
 
 #include "Helpers.h"
+#include "Metrics.h"
 #include "SHA256.h"
+#include "Sha2.h"
+#include "Sha256Constexpr.h"
+#include "Sha256Kernels.h"
 
 using namespace std;
 
 typedef unsigned char byte;
 typedef unsigned int word32;
 
-const size_t BYTE_SIZE = 8;
-const size_t WORD_SIZE = 32;
 const size_t HEX_IN_BYTE = 4;
-const size_t RESULT_WORDS_COUNT = 8;
-const size_t SCHEDULE_WORDS_COUNT = 64;
-const size_t MESSAGE_BLOCK_SIZE = 512;
-
-const size_t BYTES_IN_WORD = WORD_SIZE / BYTE_SIZE;
 const size_t WORD_HEX_SIZE = WORD_SIZE / HEX_IN_BYTE;
-const size_t MESSAGE_BLOCK_BYTES = MESSAGE_BLOCK_SIZE / BYTE_SIZE;
-const size_t MESSAGE_BLOCK_WORDS = MESSAGE_BLOCK_SIZE / WORD_SIZE;
-
-// The default K-constants for the SHA256 algorithm
-const word32 CUBE_ROOT_CONSTANTS[64] =
-{
-	0x428a2f98,0x71374491,0xb5c0fbcf,0xe9b5dba5,0x3956c25b,0x59f111f1,0x923f82a4,0xab1c5ed5,
-	0xd807aa98,0x12835b01,0x243185be,0x550c7dc3,0x72be5d74,0x80deb1fe,0x9bdc06a7,0xc19bf174,
-	0xe49b69c1,0xefbe4786,0x0fc19dc6,0x240ca1cc,0x2de92c6f,0x4a7484aa,0x5cb0a9dc,0x76f988da,
-	0x983e5152,0xa831c66d,0xb00327c8,0xbf597fc7,0xc6e00bf3,0xd5a79147,0x06ca6351,0x14292967,
-	0x27b70a85,0x2e1b2138,0x4d2c6dfc,0x53380d13,0x650a7354,0x766a0abb,0x81c2c92e,0x92722c85,
-	0xa2bfe8a1,0xa81a664b,0xc24b8b70,0xc76c51a3,0xd192e819,0xd6990624,0xf40e3585,0x106aa070,
-	0x19a4c116,0x1e376c08,0x2748774c,0x34b0bcb5,0x391c0cb3,0x4ed8aa4a,0x5b9cca4f,0x682e6ff3,
-	0x748f82ee,0x78a5636f,0x84c87814,0x8cc70208,0x90befffa,0xa4506ceb,0xbef9a3f7,0xc67178f2
+const size_t CHAR_VALUES_COUNT = 256;
+const unsigned int HEX_DIGIT_MASK = 0x0f;
+const signed char INVALID_HEX_VALUE = -1;
+const char HEX_DIGITS[] = "0123456789abcdef";
+
+// The hexadecimal value of every character or INVALID_HEX_VALUE for the characters that aren't digits
+struct HexDecodeTable
+{
+	signed char values[CHAR_VALUES_COUNT];
 };
 
-// The initial state registers for the SHA256 algorithm
-const word32 INITIAL_HASH_VALUES[RESULT_WORDS_COUNT] =
-{
-	0x6a09e667,
-	0xbb67ae85,
-	0x3c6ef372,
-	0xa54ff53a,
-	0x510e527f,
-	0x9b05688c,
-	0x1f83d9ab,
-	0x5be0cd19
+// Builds the hexadecimal decoding table at compile time
+constexpr HexDecodeTable createHexDecodeTable()
+{
+	const signed char DECIMAL_DIGITS_COUNT = 10;
+	const signed char LETTER_DIGITS_COUNT = 6;
+
+	HexDecodeTable table = { { 0 } };
+	for (size_t i = 0; i < CHAR_VALUES_COUNT; i++)
+	{
+		table.values[i] = INVALID_HEX_VALUE;
+	}
+
+	for (signed char i = 0; i < DECIMAL_DIGITS_COUNT; i++)
+	{
+		table.values['0' + i] = i;
+	}
+
+	for (signed char i = 0; i < LETTER_DIGITS_COUNT; i++)
+	{
+		table.values['a' + i] = DECIMAL_DIGITS_COUNT + i;
+		table.values['A' + i] = DECIMAL_DIGITS_COUNT + i;
+	}
+
+	return table;
+}
+
+constexpr HexDecodeTable HEX_DECODE_TABLE = createHexDecodeTable();
+
+// The digest of "abc" from the FIPS 180-2 examples, used to check the compile-time hashing
+constexpr Digest ABC_DIGEST =
+{
+	{
+		0xba,0x78,0x16,0xbf,0x8f,0x01,0xcf,0xea,0x41,0x41,0x40,0xde,0x5d,0xae,0x22,0x23,
+		0xb0,0x03,0x61,0xa3,0x96,0x17,0x7a,0x9c,0xb4,0x10,0xff,0x61,0xf2,0x00,0x15,0xad
+	}
 };
 
+static_assert(areDigestsEqual(sha256("abc"), ABC_DIGEST), "The compile-time hashing does not match the FIPS 180-2 example");
+
 // The names of each state register and its corresponding value
 enum HashValueNames
 {
@@ -105,124 +123,6 @@ bool isNullPointer(const char* ptr)
 	return ptr == nullptr;
 }
 
-/*
-	Bitwise operation functions
-*/
-
-// Validates whether the given position offset is within type size
-word32 getValidPositions(unsigned int positions)
-{
-	return positions % WORD_SIZE;
-}
-
-// Performs a bitwise right shift on a word
-word32 shift(word32 word, unsigned int positions)
-{
-	positions = getValidPositions(positions);
-
-	return word >> positions;
-}
-
-// Performs a bitwise right rotation on a word
-word32 rotate(word32 word, unsigned int positions)
-{
-	positions = getValidPositions(positions);
-
-	word32 primaryShift = word >> positions;
-	word32 excessShift = word << (WORD_SIZE - positions);
-
-	return primaryShift | excessShift;
-}
-
-// Performs bitwise addition to an array of words
-word32 add(const word32* words, size_t size)
-{
-	word32 result = 0;
-
-	for (size_t i = 0; i < size; i++)
-	{
-		result += words[i];
-	}
-
-	return result;
-}
-
-// Performs a bitwise majority operation
-// Each bit is decided by the value that has more presense in the input words
-word32 majority(word32 firstWord, word32 secondWord, word32 thirdWord)
-{
-	return (firstWord & secondWord) | (secondWord & thirdWord) | (thirdWord & firstWord);
-}
-
-// Performs a bitwise choose operation
-// Each bit is decided by a mask word and the corresponding bit in the first or second words
-word32 choose(word32 maskWord, word32 firstWord, word32 secondWord)
-{
-	return (maskWord & firstWord) ^ (~maskWord & secondWord);
-}
-
-// A general lower sigma function - performs two rotations and a shift, connected with XORs
-word32 lowerSigma(word32 word, const byte* operationValues, size_t size)
-{
-	const size_t OPERATIONS_COUNT = 3;
-	if (size != OPERATIONS_COUNT)
-	{
-		return word;
-	}
-
-	word32 result =
-		rotate(word, operationValues[0]) ^
-		rotate(word, operationValues[1]) ^
-		shift(word, operationValues[2]);
-
-	return result;
-}
-
-// A general upper sigma function - performs three rotations, connected with XORs
-word32 upperSigma(word32 word, const byte* operationValues, size_t size)
-{
-	const size_t OPERATIONS_COUNT = 3;
-	if (size != OPERATIONS_COUNT)
-	{
-		return word;
-	}
-
-	word32 result =
-		rotate(word, operationValues[0]) ^
-		rotate(word, operationValues[1]) ^
-		rotate(word, operationValues[2]);
-
-	return result;
-}
-
-// A concrete lower sigma zero bitwise function with constant parameters
-word32 lowerSigmaZero(word32 word)
-{
-	const byte LOWER_SIGMA_ZERO_OPERATIONS[] = { 7, 18, 3 };
-	return lowerSigma(word, LOWER_SIGMA_ZERO_OPERATIONS, 3);
-}
-
-// A concrete lower sigma one bitwise function with constant parameters
-word32 lowerSigmaOne(word32 word)
-{
-	const byte LOWER_SIGMA_ONE_OPERATIONS[] = { 17, 19, 10 };
-	return lowerSigma(word, LOWER_SIGMA_ONE_OPERATIONS, 3);
-}
-
-// A concrete upper sigma zero bitwise function with constant parameters
-word32 upperSigmaZero(word32 word)
-{
-	const byte UPPER_SIGMA_ZERO_OPERATIONS[] = { 2, 13, 22 };
-	return upperSigma(word, UPPER_SIGMA_ZERO_OPERATIONS, 3);
-}
-
-// A concrete upper sigma one bitwise function with constant parameters
-word32 upperSigmaOne(word32 word)
-{
-	const byte UPPER_SIGMA_ONE_OPERATIONS[] = { 6, 11, 25 };
-	return upperSigma(word, UPPER_SIGMA_ONE_OPERATIONS, 3);
-}
-
 /*
 	Message creation and padding functions
 */
@@ -295,69 +195,61 @@ void initializeBytes(byte* bytes, size_t size, byte initalValue)
 	}
 }
 
-// Creates and returns an array of bytes, representing the given size value
-byte* getInitialSizeBytes(size_t initialSize, size_t sizeBytesCount)
+// Fills a byte array with the given size value as a bit length
+// The bytes are ordered from the least significant one and values beyond the given bytes count are truncated
+void fillInitialSizeBytes(unsigned long long initialSize, byte* sizeBytes, size_t sizeBytesCount)
 {
-	byte* result = new byte[sizeBytesCount];
-	initializeBytes(result, sizeBytesCount, 0);
+	if (isNullPointer(sizeBytes))
+	{
+		return;
+	}
+
+	initializeBytes(sizeBytes, sizeBytesCount, 0);
 
-	initialSize *= BYTE_SIZE;
+	unsigned long long bitLength = initialSize * BYTE_SIZE;
 
-	unsigned int index = 0;
-	unsigned int counterOfOperations = 0;
-	while (initialSize != 0)
+	for (size_t i = 0; i < sizeBytesCount && bitLength != 0; i++)
 	{
-		byte multiplier = (1 << counterOfOperations++);
-		result[index] += initialSize % 2 * multiplier;
-		initialSize /= 2;
-		if (counterOfOperations == BYTE_SIZE)
-		{
-			index++;
-			counterOfOperations = 0;
-		}
+		sizeBytes[i] = (byte)bitLength;
+		bitLength >>= BYTE_SIZE;
 	}
-
-	return result;
 }
 
 // Appends the given initial size as bytes to the end of the padded message
-void appendInitialSize(byte* paddedMessage, size_t initialSize, size_t paddedSize, size_t sizeBytesCount)
+void appendInitialSize(byte* paddedMessage, unsigned long long initialSize, size_t paddedSize, size_t sizeBytesCount)
 {
-	if (isNullPointer(paddedMessage))
+	if (isNullPointer(paddedMessage) || sizeBytesCount > LENGTH_BYTES_COUNT)
 	{
 		return;
 	}
 
-	byte* initalSizeBytes = getInitialSizeBytes(initialSize, sizeBytesCount);
-	if (isNullPointer(initalSizeBytes))
-	{
-		return;
-	}
+	byte initalSizeBytes[LENGTH_BYTES_COUNT] = { 0 };
+	fillInitialSizeBytes(initialSize, initalSizeBytes, sizeBytesCount);
 
 	for (size_t i = 0; i < sizeBytesCount; i++)
 	{
 		paddedMessage[paddedSize - i - 1] = initalSizeBytes[i];
 	}
-
-	delete[] initalSizeBytes;
 }
 
-// Creates the total message with its padding
-void createMessage(const byte* initialMessage, size_t size, byte*& paddedMessage, size_t& totalSize)
+// Creates the padded final message blocks from the last bytes of a message that don't fill a whole block
+// The final blocks array must be able to hold FINAL_BLOCKS_MAX_BYTES bytes
+// Returns the count of created blocks (one or two)
+size_t createFinalBlocks(const byte* tail, size_t tailSize, unsigned long long totalBytes, byte* finalBlocks)
 {
-	if (paddedMessage != nullptr)
+	if (tailSize >= MESSAGE_BLOCK_BYTES || isNullPointer(finalBlocks))
 	{
-		return;
+		return 0;
 	}
 
-	const size_t INITIAL_SIZE_BYTES = 2;
-	totalSize = getTotalRequiredSize(size, INITIAL_SIZE_BYTES);
+	size_t totalSize = getTotalRequiredSize(tailSize, LENGTH_BYTES_COUNT);
 
-	paddedMessage = new byte[totalSize];
-	fillInitialMessage(initialMessage, paddedMessage, size, totalSize);
-	appendPaddingOne(paddedMessage, size, totalSize);
-	padWithZeros(paddedMessage, size, totalSize, INITIAL_SIZE_BYTES);
-	appendInitialSize(paddedMessage, size, totalSize, INITIAL_SIZE_BYTES);
+	fillInitialMessage(tail, finalBlocks, tailSize, totalSize);
+	appendPaddingOne(finalBlocks, tailSize, totalSize);
+	padWithZeros(finalBlocks, tailSize, totalSize, LENGTH_BYTES_COUNT);
+	appendInitialSize(finalBlocks, totalBytes, totalSize, LENGTH_BYTES_COUNT);
+
+	return totalSize / MESSAGE_BLOCK_BYTES;
 }
 
 /*
@@ -548,19 +440,62 @@ void hashMessageBlock(const byte* messageBlock, size_t blockBytes, word32* resul
 	}
 }
 
-// Converts a given value to hexadecimal character
-char toHexChar(unsigned int value)
+// Hashes a sequence of full message blocks with the validated reference implementation
+void hashMessageBlocksReference(const byte* messageBlocks, size_t blocksCount, word32* resultHash)
+{
+	for (size_t i = 0; i < blocksCount; i++)
+	{
+		hashMessageBlock(messageBlocks + i * MESSAGE_BLOCK_BYTES, MESSAGE_BLOCK_BYTES, resultHash, RESULT_WORDS_COUNT);
+	}
+}
+
+/*
+	Fast path hashing functions
+	They skip all validation, keep the state registers in locals and are used for the bulk of the hashing
+	The validated functions above stay as a reference implementation (see selectBlocksKernel)
+*/
+
+// Hashes a sequence of full message blocks without any validation
+// This is the SHA-2 engine specialized for 32 bit words, see Sha2.h
+void hashMessageBlocksFast(const byte* messageBlocks, size_t blocksCount, word32* resultHash)
+{
+	hashSha2BlocksFast(messageBlocks, blocksCount, resultHash);
+}
+
+// Selects the fastest block hashing kernel supported by the processor
+// Defining SHA256_REFERENCE_KERNEL routes all hashing through the validated reference implementation
+BlocksKernel selectBlocksKernel()
 {
-	const unsigned short HEX_BASE = 16;
-	value = value % HEX_BASE;
-	if (value < 10)
+#ifdef SHA256_REFERENCE_KERNEL
+	return hashMessageBlocksReference;
+#else
+	if (isShaNiSupported())
 	{
-		return value + '0';
+		return hashMessageBlocksShaNi;
 	}
-	else
+
+	return hashMessageBlocksFast;
+#endif
+}
+
+// Hashes a sequence of full message blocks with the kernel selected on first use
+void hashMessageBlocks(const byte* messageBlocks, size_t blocksCount, word32* resultHash)
+{
+	static const BlocksKernel SELECTED_KERNEL = selectBlocksKernel();
+
+	if (blocksCount == 0)
 	{
-		return value - 10 + 'a';
+		return;
 	}
+
+	SELECTED_KERNEL(messageBlocks, blocksCount, resultHash);
+}
+
+// Converts a given value to hexadecimal character
+// Only the lowest four bits of the value are used
+char toHexChar(unsigned int value)
+{
+	return HEX_DIGITS[value & HEX_DIGIT_MASK];
 }
 
 // Fills a given word as hexadecimal characters to a string
@@ -571,16 +506,28 @@ void fillCharsFromWordHex(char* charOut, size_t size, word32 word)
 		return;
 	}
 
-	int counter = WORD_HEX_SIZE - 1;
-	unsigned int mask = (1 << HEX_IN_BYTE);
-	while (counter >= 0)
+	for (size_t i = 0; i < WORD_HEX_SIZE; i++)
 	{
-		charOut[counter] = toHexChar(word % mask);
-		word /= mask;
-		counter--;
+		charOut[i] = toHexChar(word >> ((WORD_HEX_SIZE - i - 1) * HEX_IN_BYTE));
 	}
 }
 
+// Fills a given string with the hexadecimal values of the given words and a terminating zero
+// The string must have space for WORD_HEX_SIZE characters per word and the terminating zero
+void fillTextFromWords(const word32* text, size_t size, char* result)
+{
+	if (isNullPointer(text) || isNullPointer(result))
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < size; i++)
+	{
+		fillCharsFromWordHex(result + i * WORD_HEX_SIZE, WORD_HEX_SIZE, text[i]);
+	}
+	result[WORD_HEX_SIZE * size] = '\0';
+}
+
 // Creates a hash text from the hexadecimal values of the given words
 char* getTextFromWords(const word32* text, size_t size)
 {
@@ -589,67 +536,272 @@ char* getTextFromWords(const word32* text, size_t size)
 		return nullptr;
 	}
 
-	size_t resultSize = WORD_HEX_SIZE * size;
-	char* result = new char[resultSize + 1];
+	char* result = new char[WORD_HEX_SIZE * size + 1];
+	fillTextFromWords(text, size, result);
+
+	return result;
+}
+
+// Writes the given state registers as the big-endian bytes of a digest
+void storeDigest(const word32* state, Digest& digest)
+{
+	for (size_t i = 0; i < RESULT_WORDS_COUNT; i++)
+	{
+		for (size_t j = 0; j < BYTES_IN_WORD; j++)
+		{
+			digest.bytes[i * BYTES_IN_WORD + j] = (byte)(state[i] >> ((BYTES_IN_WORD - j - 1) * BYTE_SIZE));
+		}
+	}
+}
 
+// Writes the hexadecimal text of raw bytes and a terminating zero to a caller-provided string
+// The string must have space for two characters per byte and the terminating zero
+void formatHex(const unsigned char* bytes, size_t size, char* text)
+{
+	METRICS_START(formatStart);
 	for (size_t i = 0; i < size; i++)
 	{
-		fillCharsFromWordHex(result + i * WORD_HEX_SIZE, WORD_HEX_SIZE, text[i]);
+		text[2 * i] = toHexChar(bytes[i] >> HEX_IN_BYTE);
+		text[2 * i + 1] = toHexChar(bytes[i]);
 	}
-	result[resultSize] = '\0';
+	text[2 * size] = '\0';
+	METRICS_STOP(STAGE_FORMAT, formatStart);
+	METRICS_COUNT(COUNTER_DIGESTS_FORMATTED, 1);
+}
+
+// Writes the hexadecimal text of a digest and a terminating zero to a caller-provided string
+// The string must have space for DIGEST_TEXT_SIZE characters
+void formatDigest(const Digest& digest, char* text)
+{
+	formatHex(digest.bytes, DIGEST_BYTES, text);
+}
+
+// Creates a hash text from the bytes of a digest
+char* getDigestText(const Digest& digest)
+{
+	char* result = new char[DIGEST_TEXT_SIZE];
+	formatDigest(digest, result);
 
 	return result;
 }
 
-// Creates a byte array from a given string
-byte* getTextBytes(const char* text, size_t size)
+// Reads raw bytes from hexadecimal characters in either case, two characters per byte
+// The text doesn't need a terminating zero, so the bytes can be read directly out of a larger buffer
+// Returns false and leaves the bytes unspecified if the size is odd or any character isn't hexadecimal
+bool parseHex(const char* text, size_t size, unsigned char* bytes)
 {
-	if (isNullPointer(text))
+	if (text == nullptr || bytes == nullptr || size % 2 != 0)
 	{
-		return nullptr;
+		return false;
 	}
 
-	byte* result = new byte[size];
+	int invalidBits = 0;
+	for (size_t i = 0; i < size / 2; i++)
+	{
+		int highValue = HEX_DECODE_TABLE.values[(byte)text[2 * i]];
+		int lowValue = HEX_DECODE_TABLE.values[(byte)text[2 * i + 1]];
 
-	for (size_t i = 0; i < size; i++)
+		invalidBits |= highValue | lowValue;
+		bytes[i] = (byte)((highValue << HEX_IN_BYTE) | lowValue);
+	}
+
+	return invalidBits >= 0;
+}
+
+// Reads the raw bytes of a digest from exactly 2 * DIGEST_BYTES hexadecimal characters in either case
+// Returns false and leaves the digest unspecified if the size is wrong or any character isn't hexadecimal
+bool parseDigest(const char* text, size_t size, Digest& digest)
+{
+	return size == 2 * DIGEST_BYTES && parseHex(text, size, digest.bytes);
+}
+
+// Copies up to the missing amount of bytes of a block into the context buffer
+// Returns how many bytes were taken from the input
+size_t appendToBuffer(Sha256Context& context, const byte* bytes, size_t size)
+{
+	size_t missingBytes = MESSAGE_BLOCK_BYTES - context.bufferedBytes;
+	size_t bytesToCopy = size < missingBytes ? size : missingBytes;
+
+	for (size_t i = 0; i < bytesToCopy; i++)
 	{
-		result[i] = text[i];
+		context.buffer[context.bufferedBytes + i] = bytes[i];
 	}
+	context.bufferedBytes += bytesToCopy;
 
-	return result;
+	return bytesToCopy;
 }
 
-// Hashes a given string
-// The string is converted to bytes which are used for message creation
-// The message is split into blocks of 512 bits that are fed to the hashing algorithm
+// Initializes a context for a new incremental hashing operation
+void initContext(Sha256Context& context)
+{
+	initializeWords(context.state, RESULT_WORDS_COUNT);
+	initializeBytes(context.buffer, MESSAGE_BLOCK_BYTES, 0);
+	context.bufferedBytes = 0;
+	context.totalBytes = 0;
+}
+
+// Feeds more message bytes to an incremental hashing operation
+// Whole message blocks are hashed directly from the input, only a partial block is kept in the context
+void updateContext(Sha256Context& context, const void* data, size_t size)
+{
+	const byte* bytes = static_cast<const byte*>(data);
+	if (isNullPointer(bytes))
+	{
+		return;
+	}
+
+	METRICS_START(compressStart);
+	context.totalBytes += size;
+
+	if (context.bufferedBytes > 0)
+	{
+		size_t copiedBytes = appendToBuffer(context, bytes, size);
+		bytes += copiedBytes;
+		size -= copiedBytes;
+
+		if (context.bufferedBytes < MESSAGE_BLOCK_BYTES)
+		{
+			METRICS_STOP(STAGE_COMPRESS, compressStart);
+			return;
+		}
+
+		hashMessageBlocks(context.buffer, 1, context.state);
+		context.bufferedBytes = 0;
+		METRICS_COUNT(COUNTER_BLOCKS_COMPRESSED, 1);
+	}
+
+	size_t fullBlocksCount = size / MESSAGE_BLOCK_BYTES;
+	hashMessageBlocks(bytes, fullBlocksCount, context.state);
+	bytes += fullBlocksCount * MESSAGE_BLOCK_BYTES;
+	size -= fullBlocksCount * MESSAGE_BLOCK_BYTES;
+
+	appendToBuffer(context, bytes, size);
+	METRICS_STOP(STAGE_COMPRESS, compressStart);
+	METRICS_COUNT(COUNTER_BLOCKS_COMPRESSED, fullBlocksCount);
+}
+
+// Pads the buffered bytes of the context and hashes the final one or two message blocks
+// Writes the raw bytes of the final hash result and resets the context
+void finalContextDigest(Sha256Context& context, Digest& digest)
+{
+	METRICS_START(padStart);
+	byte finalBlocks[FINAL_BLOCKS_MAX_BYTES] = { 0 };
+	size_t finalBlocksCount = createFinalBlocks(context.buffer, context.bufferedBytes, context.totalBytes, finalBlocks);
+	METRICS_STOP(STAGE_PAD, padStart);
+	METRICS_COUNT(COUNTER_MESSAGES_PADDED, 1);
+
+	METRICS_START(compressStart);
+	hashMessageBlocks(finalBlocks, finalBlocksCount, context.state);
+	METRICS_STOP(STAGE_COMPRESS, compressStart);
+	METRICS_COUNT(COUNTER_BLOCKS_COMPRESSED, finalBlocksCount);
+
+	storeDigest(context.state, digest);
+	initContext(context);
+}
+
+// Finishes an incremental hashing operation and resets the context
 // Returns a string of the final hash result
-char* hashMessage(const char* initialMessage)
+char* finalContext(Sha256Context& context)
+{
+	Digest digest;
+	finalContextDigest(context, digest);
+
+	return getDigestText(digest);
+}
+
+// Hashes a suffix as the continuation of a prefix that has already been fed to a context
+// Only the suffix is compressed, the prefix context isn't changed and can be reused for any number of suffixes
+void hashSuffixDigest(const Sha256Context& prefix, const void* suffix, size_t size, Digest& digest)
+{
+	Sha256Context context = prefix;
+	updateContext(context, suffix, size);
+	finalContextDigest(context, digest);
+}
+
+// Writes a context as SERIALIZED_CONTEXT_BYTES bytes, so the hashing of a prefix can be stored and resumed later
+// The layout is the big-endian state registers, the big-endian total bytes count and the zero-padded partial block
+void serializeContext(const Sha256Context& context, unsigned char* bytes)
+{
+	Digest stateBytes;
+	storeDigest(context.state, stateBytes);
+	for (size_t i = 0; i < DIGEST_BYTES; i++)
+	{
+		bytes[i] = stateBytes.bytes[i];
+	}
+	bytes += DIGEST_BYTES;
+
+	for (size_t i = 0; i < LENGTH_BYTES_COUNT; i++)
+	{
+		bytes[i] = (byte)(context.totalBytes >> ((LENGTH_BYTES_COUNT - i - 1) * BYTE_SIZE));
+	}
+	bytes += LENGTH_BYTES_COUNT;
+
+	for (size_t i = 0; i < MESSAGE_BLOCK_BYTES; i++)
+	{
+		bytes[i] = i < context.bufferedBytes ? context.buffer[i] : 0;
+	}
+}
+
+// Restores a context written by serializeContext
+// Returns false if the size doesn't match the serialized layout
+bool deserializeContext(const unsigned char* bytes, size_t size, Sha256Context& context)
 {
-	size_t size = getLength(initialMessage);
-	byte* initialMessageBytes = getTextBytes(initialMessage, size);
+	if (isNullPointer(bytes) || size != SERIALIZED_CONTEXT_BYTES)
+	{
+		return false;
+	}
+
+	for (size_t i = 0; i < RESULT_WORDS_COUNT; i++)
+	{
+		context.state[i] = getWordFromBytes(bytes + i * BYTES_IN_WORD, BYTES_IN_WORD);
+	}
+	bytes += DIGEST_BYTES;
 
-	size_t totalMessageSize = 0;
-	byte* totalMessage = nullptr;
+	context.totalBytes = 0;
+	for (size_t i = 0; i < LENGTH_BYTES_COUNT; i++)
+	{
+		context.totalBytes = (context.totalBytes << BYTE_SIZE) | bytes[i];
+	}
+	bytes += LENGTH_BYTES_COUNT;
 
-	createMessage(initialMessageBytes, size, totalMessage, totalMessageSize);
-	size_t messageBlocksCount = totalMessageSize / MESSAGE_BLOCK_BYTES;
+	context.bufferedBytes = context.totalBytes % MESSAGE_BLOCK_BYTES;
+	for (size_t i = 0; i < MESSAGE_BLOCK_BYTES; i++)
+	{
+		context.buffer[i] = bytes[i];
+	}
 
-	delete[] initialMessageBytes;
+	return true;
+}
 
-	word32 hashResult[RESULT_WORDS_COUNT] = { 0 };
-	initializeWords(hashResult, RESULT_WORDS_COUNT);
+// Hashes a given sequence of bytes, which may contain any values including zeros
+// Writes the raw bytes of the hash result to a caller-provided digest without any heap allocations
+void hashBytesDigest(const unsigned char* bytes, size_t size, Digest& digest)
+{
+	Sha256Context context;
+	initContext(context);
+	updateContext(context, bytes, size);
+	finalContextDigest(context, digest);
+}
 
-	for (size_t i = 0; i < messageBlocksCount; i++)
+// Hashes a given sequence of bytes, which may contain any values including zeros
+// The bytes are streamed through a hashing context in blocks of 512 bits
+// Returns a string of the final hash result or a null pointer if the size can't be addressed in memory
+char* hashBytes(const unsigned char* bytes, unsigned long long size)
+{
+	if (size > (size_t)-1)
 	{
-		hashMessageBlock(
-			totalMessage + i * MESSAGE_BLOCK_BYTES, 
-			MESSAGE_BLOCK_BYTES, 
-			hashResult, 
-			RESULT_WORDS_COUNT);
+		return nullptr;
 	}
 
-	delete[] totalMessage;
+	Digest digest;
+	hashBytesDigest(bytes, (size_t)size, digest);
+
+	return getDigestText(digest);
+}
 
-	char* resultText = getTextFromWords(hashResult, RESULT_WORDS_COUNT);
-	return resultText;
+// Hashes a given string up to its terminating zero
+// Returns a string of the final hash result
+char* hashMessage(const char* initialMessage)
+{
+	return hashBytes((const unsigned char*)initialMessage, getLength(initialMessage));
 }
\ No newline at end of file
@@ -0,0 +1,254 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the multi-buffer kernel that hashes eight independent message blocks with AVX2
+* Each 32 bit lane of the vector registers holds the state of a separate message
+* The rounds can also be run over a range from a given state, for callers that precompute the first rounds
+*
+*/
+
+#include "Sha256Kernels.h"
+
+#ifdef SHA256_X86
+
+#include <immintrin.h>
+
+// GCC and Clang only emit the AVX2 instructions inside functions that enable them
+#if defined(__GNUC__) || defined(__clang__)
+#define AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define AVX2_TARGET
+#endif
+
+const size_t LANES = AVX2_LANES_COUNT;
+
+// Reads a big-endian 32 bit word from four bytes
+inline unsigned int loadWordAvx2(const unsigned char* bytes)
+{
+	return ((unsigned int)bytes[0] << 24) | ((unsigned int)bytes[1] << 16) | ((unsigned int)bytes[2] << 8) | (unsigned int)bytes[3];
+}
+
+// Performs a bitwise right rotation on every lane
+AVX2_TARGET inline __m256i rotateAvx2(__m256i word, int positions)
+{
+	return _mm256_or_si256(_mm256_srli_epi32(word, positions), _mm256_slli_epi32(word, 32 - positions));
+}
+
+// Generates the next message schedule words of every lane in a circular schedule of 16 words
+AVX2_TARGET inline __m256i expandScheduleAvx2(__m256i* schedule, size_t index)
+{
+	__m256i secondToLast = schedule[(index - 2) & 15];
+	__m256i fifteenthToLast = schedule[(index - 15) & 15];
+
+	__m256i lowerSigmaOneValue = _mm256_xor_si256(
+		_mm256_xor_si256(rotateAvx2(secondToLast, 17), rotateAvx2(secondToLast, 19)),
+		_mm256_srli_epi32(secondToLast, 10));
+	__m256i lowerSigmaZeroValue = _mm256_xor_si256(
+		_mm256_xor_si256(rotateAvx2(fifteenthToLast, 7), rotateAvx2(fifteenthToLast, 18)),
+		_mm256_srli_epi32(fifteenthToLast, 3));
+
+	schedule[index & 15] = _mm256_add_epi32(
+		_mm256_add_epi32(schedule[index & 15], lowerSigmaOneValue),
+		_mm256_add_epi32(schedule[(index - 7) & 15], lowerSigmaZeroValue));
+
+	return schedule[index & 15];
+}
+
+// Performs a single round on the state registers of every lane
+// Instead of moving the registers, the callers rotate the argument names, so only d and h are written
+AVX2_TARGET inline void hashRoundAvx2(
+	__m256i a, __m256i b, __m256i c, __m256i& d,
+	__m256i e, __m256i f, __m256i g, __m256i& h,
+	size_t round, __m256i messageWord)
+{
+	__m256i upperSigmaOneValue = _mm256_xor_si256(
+		_mm256_xor_si256(rotateAvx2(e, 6), rotateAvx2(e, 11)),
+		rotateAvx2(e, 25));
+	__m256i chooseValue = _mm256_xor_si256(g, _mm256_and_si256(e, _mm256_xor_si256(f, g)));
+	__m256i constantWord = _mm256_set1_epi32((int)CUBE_ROOT_CONSTANTS[round]);
+
+	__m256i firstTempWord = _mm256_add_epi32(
+		_mm256_add_epi32(_mm256_add_epi32(h, upperSigmaOneValue), _mm256_add_epi32(chooseValue, constantWord)),
+		messageWord);
+
+	__m256i upperSigmaZeroValue = _mm256_xor_si256(
+		_mm256_xor_si256(rotateAvx2(a, 2), rotateAvx2(a, 13)),
+		rotateAvx2(a, 22));
+	__m256i majorityValue = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+
+	d = _mm256_add_epi32(d, firstTempWord);
+	h = _mm256_add_epi32(firstTempWord, _mm256_add_epi32(upperSigmaZeroValue, majorityValue));
+}
+
+// Hashes one message block for each of the eight lanes
+AVX2_TARGET void hashLaneBlocksAvx2(const unsigned char* const* laneBlocks, unsigned int* laneStates)
+{
+	alignas(32) unsigned int transposedWords[16 * LANES];
+	for (size_t lane = 0; lane < LANES; lane++)
+	{
+		for (size_t i = 0; i < 16; i++)
+		{
+			transposedWords[i * LANES + lane] = loadWordAvx2(laneBlocks[lane] + i * 4);
+		}
+	}
+
+	__m256i schedule[16];
+	for (size_t i = 0; i < 16; i++)
+	{
+		schedule[i] = _mm256_load_si256((const __m256i*)(transposedWords + i * LANES));
+	}
+
+	__m256i initialState[8];
+	for (size_t i = 0; i < 8; i++)
+	{
+		initialState[i] = _mm256_loadu_si256((const __m256i*)(laneStates + i * LANES));
+	}
+
+	__m256i a = initialState[0], b = initialState[1], c = initialState[2], d = initialState[3];
+	__m256i e = initialState[4], f = initialState[5], g = initialState[6], h = initialState[7];
+
+	for (size_t i = 0; i < 16; i += 8)
+	{
+		hashRoundAvx2(a, b, c, d, e, f, g, h, i + 0, schedule[i + 0]);
+		hashRoundAvx2(h, a, b, c, d, e, f, g, i + 1, schedule[i + 1]);
+		hashRoundAvx2(g, h, a, b, c, d, e, f, i + 2, schedule[i + 2]);
+		hashRoundAvx2(f, g, h, a, b, c, d, e, i + 3, schedule[i + 3]);
+		hashRoundAvx2(e, f, g, h, a, b, c, d, i + 4, schedule[i + 4]);
+		hashRoundAvx2(d, e, f, g, h, a, b, c, i + 5, schedule[i + 5]);
+		hashRoundAvx2(c, d, e, f, g, h, a, b, i + 6, schedule[i + 6]);
+		hashRoundAvx2(b, c, d, e, f, g, h, a, i + 7, schedule[i + 7]);
+	}
+
+	for (size_t i = 16; i < 64; i += 8)
+	{
+		hashRoundAvx2(a, b, c, d, e, f, g, h, i + 0, expandScheduleAvx2(schedule, i + 0));
+		hashRoundAvx2(h, a, b, c, d, e, f, g, i + 1, expandScheduleAvx2(schedule, i + 1));
+		hashRoundAvx2(g, h, a, b, c, d, e, f, i + 2, expandScheduleAvx2(schedule, i + 2));
+		hashRoundAvx2(f, g, h, a, b, c, d, e, i + 3, expandScheduleAvx2(schedule, i + 3));
+		hashRoundAvx2(e, f, g, h, a, b, c, d, i + 4, expandScheduleAvx2(schedule, i + 4));
+		hashRoundAvx2(d, e, f, g, h, a, b, c, i + 5, expandScheduleAvx2(schedule, i + 5));
+		hashRoundAvx2(c, d, e, f, g, h, a, b, i + 6, expandScheduleAvx2(schedule, i + 6));
+		hashRoundAvx2(b, c, d, e, f, g, h, a, i + 7, expandScheduleAvx2(schedule, i + 7));
+	}
+
+	__m256i finalState[8] = { a, b, c, d, e, f, g, h };
+	for (size_t i = 0; i < 8; i++)
+	{
+		_mm256_storeu_si256((__m256i*)(laneStates + i * LANES), _mm256_add_epi32(initialState[i], finalState[i]));
+	}
+}
+
+// Performs the given rounds of one message block for each of the eight lanes, without adding the initial state
+// The message schedule is still generated from its first word, as the rounds may start past the sixteenth one
+AVX2_TARGET void hashLaneRoundsAvx2(const unsigned int* laneWords, unsigned int* laneStates, size_t firstRound, size_t lastRound)
+{
+	__m256i schedule[16];
+	for (size_t i = 0; i < 16; i++)
+	{
+		schedule[i] = _mm256_loadu_si256((const __m256i*)(laneWords + i * LANES));
+	}
+
+	__m256i a = _mm256_loadu_si256((const __m256i*)(laneStates + 0 * LANES)), b = _mm256_loadu_si256((const __m256i*)(laneStates + 1 * LANES));
+	__m256i c = _mm256_loadu_si256((const __m256i*)(laneStates + 2 * LANES)), d = _mm256_loadu_si256((const __m256i*)(laneStates + 3 * LANES));
+	__m256i e = _mm256_loadu_si256((const __m256i*)(laneStates + 4 * LANES)), f = _mm256_loadu_si256((const __m256i*)(laneStates + 5 * LANES));
+	__m256i g = _mm256_loadu_si256((const __m256i*)(laneStates + 6 * LANES)), h = _mm256_loadu_si256((const __m256i*)(laneStates + 7 * LANES));
+
+	for (size_t i = 0; i < lastRound; i++)
+	{
+		__m256i messageWord = i < 16 ? schedule[i] : expandScheduleAvx2(schedule, i);
+		if (i < firstRound)
+		{
+			continue;
+		}
+
+		// The round leaves the new first register in h and the new fifth one in d, the rest only move down
+		hashRoundAvx2(a, b, c, d, e, f, g, h, i, messageWord);
+		__m256i newFirstWord = h;
+		h = g;
+		g = f;
+		f = e;
+		e = d;
+		d = c;
+		c = b;
+		b = a;
+		a = newFirstWord;
+	}
+
+	__m256i finalState[8] = { a, b, c, d, e, f, g, h };
+	for (size_t i = 0; i < 8; i++)
+	{
+		_mm256_storeu_si256((__m256i*)(laneStates + i * LANES), finalState[i]);
+	}
+}
+
+#else
+
+// Never selected on processors without AVX2, hashes each lane with the portable kernel
+void hashLaneBlocksAvx2(const unsigned char* const* laneBlocks, unsigned int* laneStates)
+{
+	for (size_t lane = 0; lane < AVX2_LANES_COUNT; lane++)
+	{
+		unsigned int state[8];
+		for (size_t i = 0; i < 8; i++)
+		{
+			state[i] = laneStates[i * AVX2_LANES_COUNT + lane];
+		}
+
+		hashMessageBlocksFast(laneBlocks[lane], 1, state);
+
+		for (size_t i = 0; i < 8; i++)
+		{
+			laneStates[i * AVX2_LANES_COUNT + lane] = state[i];
+		}
+	}
+}
+
+// Never selected on processors without AVX2, performs the rounds of each lane with the portable round functions
+void hashLaneRoundsAvx2(const unsigned int* laneWords, unsigned int* laneStates, size_t firstRound, size_t lastRound)
+{
+	for (size_t lane = 0; lane < AVX2_LANES_COUNT; lane++)
+	{
+		unsigned int schedule[64];
+		for (size_t i = 0; i < 16; i++)
+		{
+			schedule[i] = laneWords[i * AVX2_LANES_COUNT + lane];
+		}
+		for (size_t i = 16; i < lastRound; i++)
+		{
+			schedule[i] = lowerSigmaOne(schedule[i - 2]) + schedule[i - 7] + lowerSigmaZero(schedule[i - 15]) + schedule[i - 16];
+		}
+
+		unsigned int state[8];
+		for (size_t i = 0; i < 8; i++)
+		{
+			state[i] = laneStates[i * AVX2_LANES_COUNT + lane];
+		}
+
+		for (size_t i = firstRound; i < lastRound; i++)
+		{
+			unsigned int firstTempWord = state[7] + upperSigmaOne(state[4]) + choose(state[4], state[5], state[6]) + CUBE_ROOT_CONSTANTS[i] + schedule[i];
+			unsigned int secondTempWord = upperSigmaZero(state[0]) + majority(state[0], state[1], state[2]);
+			for (size_t j = 7; j > 0; j--)
+			{
+				state[j] = state[j - 1];
+			}
+			state[4] += firstTempWord;
+			state[0] = firstTempWord + secondTempWord;
+		}
+
+		for (size_t i = 0; i < 8; i++)
+		{
+			laneStates[i * AVX2_LANES_COUNT + lane] = state[i];
+		}
+	}
+}
+
+#endif
\ No newline at end of file
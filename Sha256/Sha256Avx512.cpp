@@ -0,0 +1,255 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the multi-buffer kernel that hashes sixteen independent message blocks with AVX-512
+* Each 32 bit lane of the vector registers holds the state of a separate message
+* The rounds can also be run over a range from a given state, for callers that precompute the first rounds
+*
+*/
+
+#include "Sha256Kernels.h"
+
+#ifdef SHA256_X86
+
+#include <immintrin.h>
+
+// GCC and Clang only emit the AVX-512 instructions inside functions that enable them
+#if defined(__GNUC__) || defined(__clang__)
+#define AVX512_TARGET __attribute__((target("avx512f")))
+#else
+#define AVX512_TARGET
+#endif
+
+const size_t LANES = AVX512_LANES_COUNT;
+
+// Truth tables of three input bitwise functions for the ternary logic instruction
+const int XOR_TRUTH_TABLE = 0x96;
+const int CHOOSE_TRUTH_TABLE = 0xCA;
+const int MAJORITY_TRUTH_TABLE = 0xE8;
+
+// Reads a big-endian 32 bit word from four bytes
+inline unsigned int loadWordAvx512(const unsigned char* bytes)
+{
+	return ((unsigned int)bytes[0] << 24) | ((unsigned int)bytes[1] << 16) | ((unsigned int)bytes[2] << 8) | (unsigned int)bytes[3];
+}
+
+// Performs a bitwise right rotation on every lane with a native rotate instruction
+AVX512_TARGET inline __m512i rotateAvx512(__m512i word, int positions)
+{
+	return _mm512_rorv_epi32(word, _mm512_set1_epi32(positions));
+}
+
+// Generates the next message schedule words of every lane in a circular schedule of 16 words
+AVX512_TARGET inline __m512i expandScheduleAvx512(__m512i* schedule, size_t index)
+{
+	__m512i secondToLast = schedule[(index - 2) & 15];
+	__m512i fifteenthToLast = schedule[(index - 15) & 15];
+
+	__m512i lowerSigmaOneValue = _mm512_ternarylogic_epi32(
+		rotateAvx512(secondToLast, 17), rotateAvx512(secondToLast, 19), _mm512_srli_epi32(secondToLast, 10), XOR_TRUTH_TABLE);
+	__m512i lowerSigmaZeroValue = _mm512_ternarylogic_epi32(
+		rotateAvx512(fifteenthToLast, 7), rotateAvx512(fifteenthToLast, 18), _mm512_srli_epi32(fifteenthToLast, 3), XOR_TRUTH_TABLE);
+
+	schedule[index & 15] = _mm512_add_epi32(
+		_mm512_add_epi32(schedule[index & 15], lowerSigmaOneValue),
+		_mm512_add_epi32(schedule[(index - 7) & 15], lowerSigmaZeroValue));
+
+	return schedule[index & 15];
+}
+
+// Performs a single round on the state registers of every lane
+// Instead of moving the registers, the callers rotate the argument names, so only d and h are written
+AVX512_TARGET inline void hashRoundAvx512(
+	__m512i a, __m512i b, __m512i c, __m512i& d,
+	__m512i e, __m512i f, __m512i g, __m512i& h,
+	size_t round, __m512i messageWord)
+{
+	__m512i upperSigmaOneValue = _mm512_ternarylogic_epi32(
+		rotateAvx512(e, 6), rotateAvx512(e, 11), rotateAvx512(e, 25), XOR_TRUTH_TABLE);
+	__m512i chooseValue = _mm512_ternarylogic_epi32(e, f, g, CHOOSE_TRUTH_TABLE);
+	__m512i constantWord = _mm512_set1_epi32((int)CUBE_ROOT_CONSTANTS[round]);
+
+	__m512i firstTempWord = _mm512_add_epi32(
+		_mm512_add_epi32(_mm512_add_epi32(h, upperSigmaOneValue), _mm512_add_epi32(chooseValue, constantWord)),
+		messageWord);
+
+	__m512i upperSigmaZeroValue = _mm512_ternarylogic_epi32(
+		rotateAvx512(a, 2), rotateAvx512(a, 13), rotateAvx512(a, 22), XOR_TRUTH_TABLE);
+	__m512i majorityValue = _mm512_ternarylogic_epi32(a, b, c, MAJORITY_TRUTH_TABLE);
+
+	d = _mm512_add_epi32(d, firstTempWord);
+	h = _mm512_add_epi32(firstTempWord, _mm512_add_epi32(upperSigmaZeroValue, majorityValue));
+}
+
+// Hashes one message block for each of the sixteen lanes
+AVX512_TARGET void hashLaneBlocksAvx512(const unsigned char* const* laneBlocks, unsigned int* laneStates)
+{
+	alignas(64) unsigned int transposedWords[16 * LANES];
+	for (size_t lane = 0; lane < LANES; lane++)
+	{
+		for (size_t i = 0; i < 16; i++)
+		{
+			transposedWords[i * LANES + lane] = loadWordAvx512(laneBlocks[lane] + i * 4);
+		}
+	}
+
+	__m512i schedule[16];
+	for (size_t i = 0; i < 16; i++)
+	{
+		schedule[i] = _mm512_load_si512((const __m512i*)(transposedWords + i * LANES));
+	}
+
+	__m512i initialState[8];
+	for (size_t i = 0; i < 8; i++)
+	{
+		initialState[i] = _mm512_loadu_si512((const __m512i*)(laneStates + i * LANES));
+	}
+
+	__m512i a = initialState[0], b = initialState[1], c = initialState[2], d = initialState[3];
+	__m512i e = initialState[4], f = initialState[5], g = initialState[6], h = initialState[7];
+
+	for (size_t i = 0; i < 16; i += 8)
+	{
+		hashRoundAvx512(a, b, c, d, e, f, g, h, i + 0, schedule[i + 0]);
+		hashRoundAvx512(h, a, b, c, d, e, f, g, i + 1, schedule[i + 1]);
+		hashRoundAvx512(g, h, a, b, c, d, e, f, i + 2, schedule[i + 2]);
+		hashRoundAvx512(f, g, h, a, b, c, d, e, i + 3, schedule[i + 3]);
+		hashRoundAvx512(e, f, g, h, a, b, c, d, i + 4, schedule[i + 4]);
+		hashRoundAvx512(d, e, f, g, h, a, b, c, i + 5, schedule[i + 5]);
+		hashRoundAvx512(c, d, e, f, g, h, a, b, i + 6, schedule[i + 6]);
+		hashRoundAvx512(b, c, d, e, f, g, h, a, i + 7, schedule[i + 7]);
+	}
+
+	for (size_t i = 16; i < 64; i += 8)
+	{
+		hashRoundAvx512(a, b, c, d, e, f, g, h, i + 0, expandScheduleAvx512(schedule, i + 0));
+		hashRoundAvx512(h, a, b, c, d, e, f, g, i + 1, expandScheduleAvx512(schedule, i + 1));
+		hashRoundAvx512(g, h, a, b, c, d, e, f, i + 2, expandScheduleAvx512(schedule, i + 2));
+		hashRoundAvx512(f, g, h, a, b, c, d, e, i + 3, expandScheduleAvx512(schedule, i + 3));
+		hashRoundAvx512(e, f, g, h, a, b, c, d, i + 4, expandScheduleAvx512(schedule, i + 4));
+		hashRoundAvx512(d, e, f, g, h, a, b, c, i + 5, expandScheduleAvx512(schedule, i + 5));
+		hashRoundAvx512(c, d, e, f, g, h, a, b, i + 6, expandScheduleAvx512(schedule, i + 6));
+		hashRoundAvx512(b, c, d, e, f, g, h, a, i + 7, expandScheduleAvx512(schedule, i + 7));
+	}
+
+	__m512i finalState[8] = { a, b, c, d, e, f, g, h };
+	for (size_t i = 0; i < 8; i++)
+	{
+		_mm512_storeu_si512((__m512i*)(laneStates + i * LANES), _mm512_add_epi32(initialState[i], finalState[i]));
+	}
+}
+
+// Performs the given rounds of one message block for each of the sixteen lanes, without adding the initial state
+// The message schedule is still generated from its first word, as the rounds may start past the sixteenth one
+AVX512_TARGET void hashLaneRoundsAvx512(const unsigned int* laneWords, unsigned int* laneStates, size_t firstRound, size_t lastRound)
+{
+	__m512i schedule[16];
+	for (size_t i = 0; i < 16; i++)
+	{
+		schedule[i] = _mm512_loadu_si512((const __m512i*)(laneWords + i * LANES));
+	}
+
+	__m512i a = _mm512_loadu_si512((const __m512i*)(laneStates + 0 * LANES)), b = _mm512_loadu_si512((const __m512i*)(laneStates + 1 * LANES));
+	__m512i c = _mm512_loadu_si512((const __m512i*)(laneStates + 2 * LANES)), d = _mm512_loadu_si512((const __m512i*)(laneStates + 3 * LANES));
+	__m512i e = _mm512_loadu_si512((const __m512i*)(laneStates + 4 * LANES)), f = _mm512_loadu_si512((const __m512i*)(laneStates + 5 * LANES));
+	__m512i g = _mm512_loadu_si512((const __m512i*)(laneStates + 6 * LANES)), h = _mm512_loadu_si512((const __m512i*)(laneStates + 7 * LANES));
+
+	for (size_t i = 0; i < lastRound; i++)
+	{
+		__m512i messageWord = i < 16 ? schedule[i] : expandScheduleAvx512(schedule, i);
+		if (i < firstRound)
+		{
+			continue;
+		}
+
+		// The round leaves the new first register in h and the new fifth one in d, the rest only move down
+		hashRoundAvx512(a, b, c, d, e, f, g, h, i, messageWord);
+		__m512i newFirstWord = h;
+		h = g;
+		g = f;
+		f = e;
+		e = d;
+		d = c;
+		c = b;
+		b = a;
+		a = newFirstWord;
+	}
+
+	__m512i finalState[8] = { a, b, c, d, e, f, g, h };
+	for (size_t i = 0; i < 8; i++)
+	{
+		_mm512_storeu_si512((__m512i*)(laneStates + i * LANES), finalState[i]);
+	}
+}
+
+#else
+
+// Never selected on processors without AVX-512, hashes each lane with the portable kernel
+void hashLaneBlocksAvx512(const unsigned char* const* laneBlocks, unsigned int* laneStates)
+{
+	for (size_t lane = 0; lane < AVX512_LANES_COUNT; lane++)
+	{
+		unsigned int state[8];
+		for (size_t i = 0; i < 8; i++)
+		{
+			state[i] = laneStates[i * AVX512_LANES_COUNT + lane];
+		}
+
+		hashMessageBlocksFast(laneBlocks[lane], 1, state);
+
+		for (size_t i = 0; i < 8; i++)
+		{
+			laneStates[i * AVX512_LANES_COUNT + lane] = state[i];
+		}
+	}
+}
+
+// Never selected on processors without AVX-512, performs the rounds of each lane with the portable round functions
+void hashLaneRoundsAvx512(const unsigned int* laneWords, unsigned int* laneStates, size_t firstRound, size_t lastRound)
+{
+	for (size_t lane = 0; lane < AVX512_LANES_COUNT; lane++)
+	{
+		unsigned int schedule[64];
+		for (size_t i = 0; i < 16; i++)
+		{
+			schedule[i] = laneWords[i * AVX512_LANES_COUNT + lane];
+		}
+		for (size_t i = 16; i < lastRound; i++)
+		{
+			schedule[i] = lowerSigmaOne(schedule[i - 2]) + schedule[i - 7] + lowerSigmaZero(schedule[i - 15]) + schedule[i - 16];
+		}
+
+		unsigned int state[8];
+		for (size_t i = 0; i < 8; i++)
+		{
+			state[i] = laneStates[i * AVX512_LANES_COUNT + lane];
+		}
+
+		for (size_t i = firstRound; i < lastRound; i++)
+		{
+			unsigned int firstTempWord = state[7] + upperSigmaOne(state[4]) + choose(state[4], state[5], state[6]) + CUBE_ROOT_CONSTANTS[i] + schedule[i];
+			unsigned int secondTempWord = upperSigmaZero(state[0]) + majority(state[0], state[1], state[2]);
+			for (size_t j = 7; j > 0; j--)
+			{
+				state[j] = state[j - 1];
+			}
+			state[4] += firstTempWord;
+			state[0] = firstTempWord + secondTempWord;
+		}
+
+		for (size_t i = 0; i < 8; i++)
+		{
+			laneStates[i * AVX512_LANES_COUNT + lane] = state[i];
+		}
+	}
+}
+
+#endif
\ No newline at end of file
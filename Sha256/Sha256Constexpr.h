@@ -0,0 +1,313 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the constants, the round functions and the block compression of the hashing algorithm, usable at compile time
+*
+*/
+
+#pragma once
+
+#include <cstddef>
+
+#include "SHA256.h"
+
+constexpr size_t BYTE_SIZE = 8;
+constexpr size_t WORD_SIZE = 32;
+constexpr size_t RESULT_WORDS_COUNT = 8;
+constexpr size_t SCHEDULE_WORDS_COUNT = 64;
+constexpr size_t MESSAGE_BLOCK_SIZE = 512;
+constexpr size_t LENGTH_SIZE = 64;
+
+constexpr size_t BYTES_IN_WORD = WORD_SIZE / BYTE_SIZE;
+constexpr size_t MESSAGE_BLOCK_BYTES = MESSAGE_BLOCK_SIZE / BYTE_SIZE;
+constexpr size_t MESSAGE_BLOCK_WORDS = MESSAGE_BLOCK_SIZE / WORD_SIZE;
+constexpr size_t LENGTH_BYTES_COUNT = LENGTH_SIZE / BYTE_SIZE;
+
+// The default K-constants for the SHA256 algorithm
+constexpr unsigned int CUBE_ROOT_CONSTANTS[64] =
+{
+	0x428a2f98,0x71374491,0xb5c0fbcf,0xe9b5dba5,0x3956c25b,0x59f111f1,0x923f82a4,0xab1c5ed5,
+	0xd807aa98,0x12835b01,0x243185be,0x550c7dc3,0x72be5d74,0x80deb1fe,0x9bdc06a7,0xc19bf174,
+	0xe49b69c1,0xefbe4786,0x0fc19dc6,0x240ca1cc,0x2de92c6f,0x4a7484aa,0x5cb0a9dc,0x76f988da,
+	0x983e5152,0xa831c66d,0xb00327c8,0xbf597fc7,0xc6e00bf3,0xd5a79147,0x06ca6351,0x14292967,
+	0x27b70a85,0x2e1b2138,0x4d2c6dfc,0x53380d13,0x650a7354,0x766a0abb,0x81c2c92e,0x92722c85,
+	0xa2bfe8a1,0xa81a664b,0xc24b8b70,0xc76c51a3,0xd192e819,0xd6990624,0xf40e3585,0x106aa070,
+	0x19a4c116,0x1e376c08,0x2748774c,0x34b0bcb5,0x391c0cb3,0x4ed8aa4a,0x5b9cca4f,0x682e6ff3,
+	0x748f82ee,0x78a5636f,0x84c87814,0x8cc70208,0x90befffa,0xa4506ceb,0xbef9a3f7,0xc67178f2
+};
+
+// The initial state registers for the SHA256 algorithm
+constexpr unsigned int INITIAL_HASH_VALUES[RESULT_WORDS_COUNT] =
+{
+	0x6a09e667,
+	0xbb67ae85,
+	0x3c6ef372,
+	0xa54ff53a,
+	0x510e527f,
+	0x9b05688c,
+	0x1f83d9ab,
+	0x5be0cd19
+};
+
+/*
+	Bitwise operation functions
+*/
+
+// Validates whether the given position offset is within type size
+constexpr unsigned int getValidPositions(unsigned int positions)
+{
+	return positions % WORD_SIZE;
+}
+
+// Performs a bitwise right shift on a word
+constexpr unsigned int shift(unsigned int word, unsigned int positions)
+{
+	positions = getValidPositions(positions);
+
+	return word >> positions;
+}
+
+// Performs a bitwise right rotation on a word
+constexpr unsigned int rotate(unsigned int word, unsigned int positions)
+{
+	positions = getValidPositions(positions);
+
+	unsigned int primaryShift = word >> positions;
+	unsigned int excessShift = word << (WORD_SIZE - positions);
+
+	return primaryShift | excessShift;
+}
+
+// Performs bitwise addition to an array of words
+constexpr unsigned int add(const unsigned int* words, size_t size)
+{
+	unsigned int result = 0;
+
+	for (size_t i = 0; i < size; i++)
+	{
+		result += words[i];
+	}
+
+	return result;
+}
+
+// Performs a bitwise majority operation
+// Each bit is decided by the value that has more presense in the input words
+constexpr unsigned int majority(unsigned int firstWord, unsigned int secondWord, unsigned int thirdWord)
+{
+	return (firstWord & secondWord) | (secondWord & thirdWord) | (thirdWord & firstWord);
+}
+
+// Performs a bitwise choose operation
+// Each bit is decided by a mask word and the corresponding bit in the first or second words
+constexpr unsigned int choose(unsigned int maskWord, unsigned int firstWord, unsigned int secondWord)
+{
+	return (maskWord & firstWord) ^ (~maskWord & secondWord);
+}
+
+// A general lower sigma function - performs two rotations and a shift, connected with XORs
+constexpr unsigned int lowerSigma(unsigned int word, const unsigned char* operationValues, size_t size)
+{
+	const size_t OPERATIONS_COUNT = 3;
+	if (size != OPERATIONS_COUNT)
+	{
+		return word;
+	}
+
+	unsigned int result =
+		rotate(word, operationValues[0]) ^
+		rotate(word, operationValues[1]) ^
+		shift(word, operationValues[2]);
+
+	return result;
+}
+
+// A general upper sigma function - performs three rotations, connected with XORs
+constexpr unsigned int upperSigma(unsigned int word, const unsigned char* operationValues, size_t size)
+{
+	const size_t OPERATIONS_COUNT = 3;
+	if (size != OPERATIONS_COUNT)
+	{
+		return word;
+	}
+
+	unsigned int result =
+		rotate(word, operationValues[0]) ^
+		rotate(word, operationValues[1]) ^
+		rotate(word, operationValues[2]);
+
+	return result;
+}
+
+// A concrete lower sigma zero bitwise function with constant parameters
+constexpr unsigned int lowerSigmaZero(unsigned int word)
+{
+	const unsigned char LOWER_SIGMA_ZERO_OPERATIONS[] = { 7, 18, 3 };
+	return lowerSigma(word, LOWER_SIGMA_ZERO_OPERATIONS, 3);
+}
+
+// A concrete lower sigma one bitwise function with constant parameters
+constexpr unsigned int lowerSigmaOne(unsigned int word)
+{
+	const unsigned char LOWER_SIGMA_ONE_OPERATIONS[] = { 17, 19, 10 };
+	return lowerSigma(word, LOWER_SIGMA_ONE_OPERATIONS, 3);
+}
+
+// A concrete upper sigma zero bitwise function with constant parameters
+constexpr unsigned int upperSigmaZero(unsigned int word)
+{
+	const unsigned char UPPER_SIGMA_ZERO_OPERATIONS[] = { 2, 13, 22 };
+	return upperSigma(word, UPPER_SIGMA_ZERO_OPERATIONS, 3);
+}
+
+// A concrete upper sigma one bitwise function with constant parameters
+constexpr unsigned int upperSigmaOne(unsigned int word)
+{
+	const unsigned char UPPER_SIGMA_ONE_OPERATIONS[] = { 6, 11, 25 };
+	return upperSigma(word, UPPER_SIGMA_ONE_OPERATIONS, 3);
+}
+
+/*
+	Compile-time hashing functions
+*/
+
+// The eight state registers, wrapped so they can be passed and returned by value at compile time
+struct ConstexprState
+{
+	unsigned int words[RESULT_WORDS_COUNT];
+};
+
+// Calculates the padded size of a message with the given bytes count
+constexpr size_t getConstexprPaddedSize(size_t textSize)
+{
+	return (textSize + 1 + LENGTH_BYTES_COUNT + MESSAGE_BLOCK_BYTES - 1) / MESSAGE_BLOCK_BYTES * MESSAGE_BLOCK_BYTES;
+}
+
+// Reads the byte at the given position of the padded message without building the padded message
+constexpr unsigned char getConstexprPaddedByte(const char* text, size_t textSize, size_t position)
+{
+	const unsigned char PADDING_ONE = 0b10000000;
+
+	if (position < textSize)
+	{
+		return (unsigned char)text[position];
+	}
+
+	if (position == textSize)
+	{
+		return PADDING_ONE;
+	}
+
+	size_t paddedSize = getConstexprPaddedSize(textSize);
+	if (position < paddedSize - LENGTH_BYTES_COUNT)
+	{
+		return 0;
+	}
+
+	unsigned long long bitLength = (unsigned long long)textSize * BYTE_SIZE;
+	size_t lengthShift = (paddedSize - 1 - position) * BYTE_SIZE;
+
+	return (unsigned char)(bitLength >> lengthShift);
+}
+
+// Compresses one block of the padded message into the state registers
+constexpr ConstexprState compressConstexprBlock(ConstexprState state, const char* text, size_t textSize, size_t blockIndex)
+{
+	unsigned int schedule[SCHEDULE_WORDS_COUNT] = { 0 };
+
+	size_t blockStart = blockIndex * MESSAGE_BLOCK_BYTES;
+	for (size_t i = 0; i < MESSAGE_BLOCK_WORDS; i++)
+	{
+		for (size_t j = 0; j < BYTES_IN_WORD; j++)
+		{
+			schedule[i] = (schedule[i] << BYTE_SIZE) | getConstexprPaddedByte(text, textSize, blockStart + i * BYTES_IN_WORD + j);
+		}
+	}
+
+	for (size_t i = MESSAGE_BLOCK_WORDS; i < SCHEDULE_WORDS_COUNT; i++)
+	{
+		schedule[i] = lowerSigmaOne(schedule[i - 2]) + schedule[i - 7] + lowerSigmaZero(schedule[i - 15]) + schedule[i - 16];
+	}
+
+	unsigned int registers[RESULT_WORDS_COUNT] = { 0 };
+	for (size_t i = 0; i < RESULT_WORDS_COUNT; i++)
+	{
+		registers[i] = state.words[i];
+	}
+
+	for (size_t i = 0; i < SCHEDULE_WORDS_COUNT; i++)
+	{
+		unsigned int firstTempWord = registers[7] + upperSigmaOne(registers[4]) +
+			choose(registers[4], registers[5], registers[6]) + CUBE_ROOT_CONSTANTS[i] + schedule[i];
+		unsigned int secondTempWord = upperSigmaZero(registers[0]) + majority(registers[0], registers[1], registers[2]);
+
+		for (size_t j = RESULT_WORDS_COUNT - 1; j > 0; j--)
+		{
+			registers[j] = registers[j - 1];
+		}
+
+		registers[4] += firstTempWord;
+		registers[0] = firstTempWord + secondTempWord;
+	}
+
+	for (size_t i = 0; i < RESULT_WORDS_COUNT; i++)
+	{
+		state.words[i] += registers[i];
+	}
+
+	return state;
+}
+
+// Hashes a text of the given size at compile time
+constexpr Digest getConstexprDigest(const char* text, size_t textSize)
+{
+	ConstexprState state = { { 0 } };
+	for (size_t i = 0; i < RESULT_WORDS_COUNT; i++)
+	{
+		state.words[i] = INITIAL_HASH_VALUES[i];
+	}
+
+	size_t blocksCount = getConstexprPaddedSize(textSize) / MESSAGE_BLOCK_BYTES;
+	for (size_t i = 0; i < blocksCount; i++)
+	{
+		state = compressConstexprBlock(state, text, textSize, i);
+	}
+
+	Digest digest = { { 0 } };
+	for (size_t i = 0; i < DIGEST_BYTES; i++)
+	{
+		size_t wordShift = (BYTES_IN_WORD - 1 - i % BYTES_IN_WORD) * BYTE_SIZE;
+		digest.bytes[i] = (unsigned char)(state.words[i / BYTES_IN_WORD] >> wordShift);
+	}
+
+	return digest;
+}
+
+// Hashes a string literal at compile time - the terminating zero is not part of the message
+// Use as constexpr Digest CONFIG_DIGEST = sha256("...");
+template <size_t N>
+constexpr Digest sha256(const char (&text)[N])
+{
+	return getConstexprDigest(text, N - 1);
+}
+
+// Compares two digests, usable at compile time
+// Every byte is always compared, so the time taken doesn't reveal where the first difference is
+constexpr bool areDigestsEqual(const Digest& first, const Digest& second)
+{
+	unsigned char difference = 0;
+	for (size_t i = 0; i < DIGEST_BYTES; i++)
+	{
+		difference |= first.bytes[i] ^ second.bytes[i];
+	}
+
+	return difference == 0;
+}
\ No newline at end of file
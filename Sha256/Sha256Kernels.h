@@ -0,0 +1,52 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains declarations of the block hashing kernels shared by the hashing algorithm files
+*
+*/
+
+#pragma once
+
+#include <cstddef>
+
+#include "CpuFeatures.h"
+#include "SHA256.h"
+#include "Sha256Constexpr.h"
+
+const size_t FINAL_BLOCKS_MAX_BYTES = 128;
+const size_t AVX2_LANES_COUNT = 8;
+const size_t AVX512_LANES_COUNT = 16;
+
+// A function that hashes a sequence of full 64 byte message blocks into the eight state registers
+typedef void (*BlocksKernel)(const unsigned char* messageBlocks, size_t blocksCount, unsigned int* resultHash);
+
+// A function that hashes one message block for each lane of independent messages
+// The lane states are interleaved - state register i of lane j is at index i * lanesCount + j
+typedef void (*LanesKernel)(const unsigned char* const* laneBlocks, unsigned int* laneStates);
+
+// A function that performs a range of the rounds of one message block for each lane, from the state before the first of them
+// The sixteen message words are interleaved the same way as the lane states, which are left without the initial state added
+typedef void (*LaneRoundsKernel)(const unsigned int* laneWords, unsigned int* laneStates, size_t firstRound, size_t lastRound);
+
+size_t createFinalBlocks(const unsigned char* tail, size_t tailSize, unsigned long long totalBytes, unsigned char* finalBlocks);
+void hashMessageBlocks(const unsigned char* messageBlocks, size_t blocksCount, unsigned int* resultHash);
+void storeDigest(const unsigned int* state, Digest& digest);
+
+void hashMessageBlocksReference(const unsigned char* messageBlocks, size_t blocksCount, unsigned int* resultHash);
+void hashMessageBlocksFast(const unsigned char* messageBlocks, size_t blocksCount, unsigned int* resultHash);
+void hashMessageBlocksShaNi(const unsigned char* messageBlocks, size_t blocksCount, unsigned int* resultHash);
+
+void hashLaneBlocksAvx2(const unsigned char* const* laneBlocks, unsigned int* laneStates);
+void hashLaneBlocksAvx512(const unsigned char* const* laneBlocks, unsigned int* laneStates);
+void hashLaneRoundsAvx2(const unsigned int* laneWords, unsigned int* laneStates, size_t firstRound, size_t lastRound);
+void hashLaneRoundsAvx512(const unsigned int* laneWords, unsigned int* laneStates, size_t firstRound, size_t lastRound);
+LanesKernel selectLanesKernel(size_t& lanesCount);
+LaneRoundsKernel selectLaneRoundsKernel(size_t& lanesCount);
\ No newline at end of file
@@ -0,0 +1,329 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the batch hashing of many independent messages
+* The messages are scheduled over the lanes of a multi-buffer kernel, so each vector instruction works on several messages
+*
+*/
+
+#include "Metrics.h"
+#include "SHA256.h"
+#include "Sha256Kernels.h"
+
+typedef unsigned char byte;
+typedef unsigned int word32;
+
+const size_t BLOCK_BYTES = 64;
+const size_t STATE_WORDS = 8;
+const size_t MAX_LANES_COUNT = AVX512_LANES_COUNT;
+
+// The block hashed by lanes that have no message assigned, their results are ignored
+const byte IDLE_LANE_BLOCK[BLOCK_BYTES] = { 0 };
+
+// The progress of a single message that is assigned to a lane
+// A message resumed from a prefix with a partial block starts with a lead block of the prefix and message bytes
+struct LaneMessage
+{
+	size_t inputIndex;
+	byte leadBlock[BLOCK_BYTES];
+	bool hasLeadBlock;
+	const byte* nextBlock;
+	size_t fullBlocksLeft;
+	byte finalBlocks[FINAL_BLOCKS_MAX_BYTES];
+	size_t finalBlocksCount;
+	size_t finalBlocksDone;
+	bool isActive;
+};
+
+// Prepares a lane for hashing a new message that continues the given prefix
+// The full blocks are read from the input directly, only the lead block and the padded final blocks are kept in the lane
+void startLaneMessage(LaneMessage& lane, const MessageSpan& input, size_t inputIndex, const Sha256Context& prefix)
+{
+	const byte* bytes = static_cast<const byte*>(input.data);
+	size_t size = input.size;
+	unsigned long long totalBytes = prefix.totalBytes + size;
+
+	lane.inputIndex = inputIndex;
+	lane.hasLeadBlock = false;
+	lane.finalBlocksDone = 0;
+	lane.isActive = true;
+
+	size_t leadBytes = prefix.bufferedBytes;
+	if (leadBytes > 0 && leadBytes + size < BLOCK_BYTES)
+	{
+		byte tail[BLOCK_BYTES];
+		for (size_t i = 0; i < leadBytes; i++)
+		{
+			tail[i] = prefix.buffer[i];
+		}
+		for (size_t i = 0; i < size; i++)
+		{
+			tail[leadBytes + i] = bytes[i];
+		}
+
+		lane.nextBlock = bytes;
+		lane.fullBlocksLeft = 0;
+		lane.finalBlocksCount = createFinalBlocks(tail, leadBytes + size, totalBytes, lane.finalBlocks);
+		return;
+	}
+
+	if (leadBytes > 0)
+	{
+		size_t missingBytes = BLOCK_BYTES - leadBytes;
+		for (size_t i = 0; i < leadBytes; i++)
+		{
+			lane.leadBlock[i] = prefix.buffer[i];
+		}
+		for (size_t i = 0; i < missingBytes; i++)
+		{
+			lane.leadBlock[leadBytes + i] = bytes[i];
+		}
+
+		lane.hasLeadBlock = true;
+		bytes += missingBytes;
+		size -= missingBytes;
+	}
+
+	size_t tailSize = size % BLOCK_BYTES;
+
+	lane.nextBlock = bytes;
+	lane.fullBlocksLeft = size / BLOCK_BYTES;
+	lane.finalBlocksCount = createFinalBlocks(bytes + (size - tailSize), tailSize, totalBytes, lane.finalBlocks);
+}
+
+// Returns the next block of the lane's message
+const byte* getLaneBlock(const LaneMessage& lane)
+{
+	if (lane.hasLeadBlock)
+	{
+		return lane.leadBlock;
+	}
+
+	if (lane.fullBlocksLeft > 0)
+	{
+		return lane.nextBlock;
+	}
+
+	return lane.finalBlocks + lane.finalBlocksDone * BLOCK_BYTES;
+}
+
+// Moves the lane to the next block of its message
+// Returns true if the whole message has been hashed
+bool advanceLane(LaneMessage& lane)
+{
+	if (lane.hasLeadBlock)
+	{
+		lane.hasLeadBlock = false;
+		return false;
+	}
+
+	if (lane.fullBlocksLeft > 0)
+	{
+		lane.nextBlock += BLOCK_BYTES;
+		lane.fullBlocksLeft--;
+	}
+	else
+	{
+		lane.finalBlocksDone++;
+	}
+
+	return lane.fullBlocksLeft == 0 && lane.finalBlocksDone == lane.finalBlocksCount;
+}
+
+// Copies the state registers of the prefix into the given lane of the interleaved lane states
+void resetLaneState(word32* laneStates, size_t lanesCount, size_t lane, const Sha256Context& prefix)
+{
+	for (size_t i = 0; i < STATE_WORDS; i++)
+	{
+		laneStates[i * lanesCount + lane] = prefix.state[i];
+	}
+}
+
+// Copies the state registers of the given lane out of the interleaved lane states
+void extractLaneState(const word32* laneStates, size_t lanesCount, size_t lane, word32* state)
+{
+	for (size_t i = 0; i < STATE_WORDS; i++)
+	{
+		state[i] = laneStates[i * lanesCount + lane];
+	}
+}
+
+// Hashes the remaining blocks of a lane's message with the single message kernel
+void finishLaneMessage(LaneMessage& lane, word32* state, Digest& result)
+{
+	if (lane.hasLeadBlock)
+	{
+		hashMessageBlocks(lane.leadBlock, 1, state);
+		lane.hasLeadBlock = false;
+	}
+
+	hashMessageBlocks(lane.nextBlock, lane.fullBlocksLeft, state);
+	hashMessageBlocks(
+		lane.finalBlocks + lane.finalBlocksDone * BLOCK_BYTES,
+		lane.finalBlocksCount - lane.finalBlocksDone,
+		state);
+
+	storeDigest(state, result);
+	lane.isActive = false;
+}
+
+// Hashes the messages one by one with the single message kernel
+void hashEachMessage(const Sha256Context& prefix, const MessageSpan* inputs, size_t count, Digest* results)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		hashSuffixDigest(prefix, inputs[i].data, inputs[i].size, results[i]);
+	}
+}
+
+// Hashes the messages over the lanes of the given kernel
+// A lane takes the next waiting message as soon as its current one is done, so messages of different lengths keep the lanes busy
+// Once there are no waiting messages and fewer than half of the lanes are busy, the rest are finished one by one
+void hashMessagesInLanes(
+	const Sha256Context& prefix,
+	const MessageSpan* inputs, size_t count, Digest* results,
+	LanesKernel kernel, size_t lanesCount)
+{
+	LaneMessage lanes[MAX_LANES_COUNT];
+	word32 laneStates[STATE_WORDS * MAX_LANES_COUNT];
+	const byte* laneBlocks[MAX_LANES_COUNT];
+
+	size_t nextInput = 0;
+	size_t activeLanes = 0;
+	for (size_t lane = 0; lane < lanesCount; lane++)
+	{
+		lanes[lane].isActive = false;
+		if (nextInput < count)
+		{
+			startLaneMessage(lanes[lane], inputs[nextInput], nextInput, prefix);
+			resetLaneState(laneStates, lanesCount, lane, prefix);
+			nextInput++;
+			activeLanes++;
+		}
+	}
+
+	METRICS_START(compressStart);
+	unsigned long long compressedBlocksCount = 0;
+	while (activeLanes > 0 && activeLanes * 2 >= lanesCount)
+	{
+		for (size_t lane = 0; lane < lanesCount; lane++)
+		{
+			laneBlocks[lane] = lanes[lane].isActive ? getLaneBlock(lanes[lane]) : IDLE_LANE_BLOCK;
+		}
+
+		kernel(laneBlocks, laneStates);
+		compressedBlocksCount += activeLanes;
+
+		for (size_t lane = 0; lane < lanesCount; lane++)
+		{
+			if (!lanes[lane].isActive || !advanceLane(lanes[lane]))
+			{
+				continue;
+			}
+
+			word32 state[STATE_WORDS];
+			extractLaneState(laneStates, lanesCount, lane, state);
+			storeDigest(state, results[lanes[lane].inputIndex]);
+			lanes[lane].isActive = false;
+			activeLanes--;
+
+			if (nextInput < count)
+			{
+				startLaneMessage(lanes[lane], inputs[nextInput], nextInput, prefix);
+				resetLaneState(laneStates, lanesCount, lane, prefix);
+				nextInput++;
+				activeLanes++;
+			}
+		}
+	}
+
+	METRICS_STOP(STAGE_COMPRESS, compressStart);
+	METRICS_COUNT(COUNTER_BLOCKS_COMPRESSED, compressedBlocksCount);
+
+	for (size_t lane = 0; lane < lanesCount; lane++)
+	{
+		if (lanes[lane].isActive)
+		{
+			word32 state[STATE_WORDS];
+			extractLaneState(laneStates, lanesCount, lane, state);
+			finishLaneMessage(lanes[lane], state, results[lanes[lane].inputIndex]);
+		}
+	}
+}
+
+// Selects the multi-buffer kernel with the most lanes supported by the processor
+// The SHA extensions hash a single message faster than eight AVX2 lanes, so AVX2 is only used without them
+// Returns a null kernel and zero lanes if the messages should be hashed one by one
+LanesKernel selectLanesKernel(size_t& lanesCount)
+{
+	if (isAvx512Supported())
+	{
+		lanesCount = AVX512_LANES_COUNT;
+		return hashLaneBlocksAvx512;
+	}
+
+	if (isAvx2Supported() && !isShaNiSupported())
+	{
+		lanesCount = AVX2_LANES_COUNT;
+		return hashLaneBlocksAvx2;
+	}
+
+	lanesCount = 0;
+	return nullptr;
+}
+
+// Chooses the lane rounds kernel that goes with the lanes kernel chosen on this processor
+// Returns null and zero lanes when the lanes kernel isn't used either
+LaneRoundsKernel selectLaneRoundsKernel(size_t& lanesCount)
+{
+	LanesKernel lanesKernel = selectLanesKernel(lanesCount);
+	if (lanesKernel == hashLaneBlocksAvx512)
+	{
+		return hashLaneRoundsAvx512;
+	}
+
+	if (lanesKernel == hashLaneBlocksAvx2)
+	{
+		return hashLaneRoundsAvx2;
+	}
+
+	return nullptr;
+}
+
+// Hashes a batch of messages that all continue the same prefix and writes their raw digests in the same order
+// The prefix is a context that has already been fed the shared bytes, it isn't changed
+void hashManySuffixes(const Sha256Context& prefix, const MessageSpan* inputs, size_t count, Digest* results)
+{
+	if (inputs == nullptr || results == nullptr)
+	{
+		return;
+	}
+
+	static size_t lanesCount = 0;
+	static const LanesKernel SELECTED_KERNEL = selectLanesKernel(lanesCount);
+
+	if (SELECTED_KERNEL == nullptr)
+	{
+		hashEachMessage(prefix, inputs, count, results);
+		return;
+	}
+
+	hashMessagesInLanes(prefix, inputs, count, results, SELECTED_KERNEL, lanesCount);
+}
+
+// Hashes a batch of independent messages and writes their raw digests in the same order
+void hashMany(const MessageSpan* inputs, size_t count, Digest* results)
+{
+	Sha256Context initialContext;
+	initContext(initialContext);
+
+	hashManySuffixes(initialContext, inputs, count, results);
+}
\ No newline at end of file
@@ -0,0 +1,124 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the block hashing kernel that uses the Intel SHA extensions
+* It is only selected when the processor reports support for them
+*
+*/
+
+#include "Sha256Kernels.h"
+
+#ifdef SHA256_X86
+
+#include <immintrin.h>
+
+// GCC and Clang only emit the extension instructions inside functions that enable them
+#if defined(__GNUC__) || defined(__clang__)
+#define SHA_NI_TARGET __attribute__((target("sha,sse4.1,ssse3")))
+#else
+#define SHA_NI_TARGET
+#endif
+
+// Loads four message words and converts them from big-endian
+SHA_NI_TARGET inline __m128i loadMessageShaNi(const unsigned char* bytes)
+{
+	const __m128i BYTE_SWAP_MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+	return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)bytes), BYTE_SWAP_MASK);
+}
+
+// Performs four rounds on the ABEF and CDGH state halves with the given four message words
+SHA_NI_TARGET inline void hashFourRoundsShaNi(__m128i& stateAbef, __m128i& stateCdgh, __m128i message, size_t round)
+{
+	__m128i roundInput = _mm_add_epi32(message, _mm_loadu_si128((const __m128i*)(CUBE_ROOT_CONSTANTS + round)));
+
+	stateCdgh = _mm_sha256rnds2_epu32(stateCdgh, stateAbef, roundInput);
+	roundInput = _mm_shuffle_epi32(roundInput, 0x0E);
+	stateAbef = _mm_sha256rnds2_epu32(stateAbef, stateCdgh, roundInput);
+}
+
+// Completes the next four schedule words from their partial sums and the two previous groups of words
+SHA_NI_TARGET inline __m128i finishScheduleShaNi(__m128i next, __m128i current, __m128i previous)
+{
+	next = _mm_add_epi32(next, _mm_alignr_epi8(current, previous, 4));
+	return _mm_sha256msg2_epu32(next, current);
+}
+
+// Hashes a sequence of full message blocks with the SHA extensions
+// The eight state registers are kept as the ABEF and CDGH halves the instructions work with
+SHA_NI_TARGET void hashMessageBlocksShaNi(const unsigned char* messageBlocks, size_t blocksCount, unsigned int* resultHash)
+{
+	__m128i stateCdab = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)resultHash), 0xB1);
+	__m128i stateEfgh = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(resultHash + 4)), 0x1B);
+	__m128i stateAbef = _mm_alignr_epi8(stateCdab, stateEfgh, 8);
+	__m128i stateCdgh = _mm_blend_epi16(stateEfgh, stateCdab, 0xF0);
+
+	for (size_t block = 0; block < blocksCount; block++)
+	{
+		const unsigned char* messageBlock = messageBlocks + block * 64;
+		__m128i savedAbef = stateAbef;
+		__m128i savedCdgh = stateCdgh;
+
+		__m128i message0 = loadMessageShaNi(messageBlock);
+		hashFourRoundsShaNi(stateAbef, stateCdgh, message0, 0);
+
+		__m128i message1 = loadMessageShaNi(messageBlock + 16);
+		hashFourRoundsShaNi(stateAbef, stateCdgh, message1, 4);
+		message0 = _mm_sha256msg1_epu32(message0, message1);
+
+		__m128i message2 = loadMessageShaNi(messageBlock + 32);
+		hashFourRoundsShaNi(stateAbef, stateCdgh, message2, 8);
+		message1 = _mm_sha256msg1_epu32(message1, message2);
+
+		__m128i message3 = loadMessageShaNi(messageBlock + 48);
+		hashFourRoundsShaNi(stateAbef, stateCdgh, message3, 12);
+		message0 = finishScheduleShaNi(message0, message3, message2);
+		message2 = _mm_sha256msg1_epu32(message2, message3);
+
+		// The last pass computes a few schedule words that are never used, which keeps the loop uniform
+		for (size_t round = 16; round < 64; round += 16)
+		{
+			hashFourRoundsShaNi(stateAbef, stateCdgh, message0, round);
+			message1 = finishScheduleShaNi(message1, message0, message3);
+			message3 = _mm_sha256msg1_epu32(message3, message0);
+
+			hashFourRoundsShaNi(stateAbef, stateCdgh, message1, round + 4);
+			message2 = finishScheduleShaNi(message2, message1, message0);
+			message0 = _mm_sha256msg1_epu32(message0, message1);
+
+			hashFourRoundsShaNi(stateAbef, stateCdgh, message2, round + 8);
+			message3 = finishScheduleShaNi(message3, message2, message1);
+			message1 = _mm_sha256msg1_epu32(message1, message2);
+
+			hashFourRoundsShaNi(stateAbef, stateCdgh, message3, round + 12);
+			message0 = finishScheduleShaNi(message0, message3, message2);
+			message2 = _mm_sha256msg1_epu32(message2, message3);
+		}
+
+		stateAbef = _mm_add_epi32(stateAbef, savedAbef);
+		stateCdgh = _mm_add_epi32(stateCdgh, savedCdgh);
+	}
+
+	__m128i stateFeba = _mm_shuffle_epi32(stateAbef, 0x1B);
+	__m128i stateDchg = _mm_shuffle_epi32(stateCdgh, 0xB1);
+	_mm_storeu_si128((__m128i*)resultHash, _mm_blend_epi16(stateFeba, stateDchg, 0xF0));
+	_mm_storeu_si128((__m128i*)(resultHash + 4), _mm_alignr_epi8(stateDchg, stateFeba, 8));
+}
+
+#else
+
+// Never selected on processors without the SHA extensions, falls back to the portable kernel
+void hashMessageBlocksShaNi(const unsigned char* messageBlocks, size_t blocksCount, unsigned int* resultHash)
+{
+	hashMessageBlocksFast(messageBlocks, blocksCount, resultHash);
+}
+
+#endif
\ No newline at end of file
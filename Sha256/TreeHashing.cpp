@@ -0,0 +1,155 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the parallel tree hashing of files
+* The file is split into fixed-size chunks that are hashed on separate threads as the leaves of a Merkle tree
+* The tree follows RFC 6962 - a leaf is SHA256(0x00 || chunk) and a node is SHA256(0x01 || left || right)
+* A node without a pair is moved up a level unchanged, and an empty file is a tree with a single empty leaf
+*
+*/
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "FileHashing.h"
+#include "SHA256.h"
+#include "TreeHashing.h"
+
+using namespace std;
+
+const unsigned char LEAF_PREFIX = 0x00;
+const unsigned char NODE_PREFIX = 0x01;
+
+// The file whose chunks are hashed and the leaf digests, shared between the workers
+struct TreeLeaves
+{
+	ReadableFile file;
+	size_t chunkBytes;
+	vector<Digest> digests;
+	atomic<size_t> nextChunk;
+	atomic<bool> hasFailed;
+};
+
+// Starts a leaf hash - a context that has been fed the leaf prefix and continues with the leaf bytes
+void initTreeLeafContext(Sha256Context& context)
+{
+	initContext(context);
+	updateContext(context, &LEAF_PREFIX, 1);
+}
+
+// Hashes a leaf of the tree from its bytes
+void hashTreeLeaf(const void* data, size_t size, Digest& leaf)
+{
+	Sha256Context context;
+	initTreeLeafContext(context);
+	updateContext(context, data, size);
+	finalContextDigest(context, leaf);
+}
+
+// Hashes a node of the tree from its two children
+void hashTreeNode(const Digest& left, const Digest& right, Digest& node)
+{
+	Sha256Context context;
+	initContext(context);
+	updateContext(context, &NODE_PREFIX, 1);
+	updateContext(context, left.bytes, DIGEST_BYTES);
+	updateContext(context, right.bytes, DIGEST_BYTES);
+	finalContextDigest(context, node);
+}
+
+// Takes the next chunk that isn't hashed yet until there are none left
+void hashLeavesWorker(TreeLeaves& leaves)
+{
+	unsigned char* chunk = new unsigned char[leaves.chunkBytes];
+
+	size_t index = leaves.nextChunk++;
+	while (index < leaves.digests.size() && !leaves.hasFailed)
+	{
+		unsigned long long offset = (unsigned long long)index * leaves.chunkBytes;
+		long long bytesRead = readFileAt(leaves.file, offset, chunk, leaves.chunkBytes);
+		if (bytesRead < 0)
+		{
+			leaves.hasFailed = true;
+			break;
+		}
+
+		hashTreeLeaf(chunk, (size_t)bytesRead, leaves.digests[index]);
+
+		index = leaves.nextChunk++;
+	}
+
+	delete[] chunk;
+}
+
+// Combines the leaf digests level by level until only the root is left
+void reduceTreeLevels(vector<Digest>& level)
+{
+	while (level.size() > 1)
+	{
+		size_t pairsCount = level.size() / 2;
+		for (size_t i = 0; i < pairsCount; i++)
+		{
+			hashTreeNode(level[2 * i], level[2 * i + 1], level[i]);
+		}
+
+		if (level.size() % 2 != 0)
+		{
+			level[pairsCount] = level.back();
+			pairsCount++;
+		}
+
+		level.resize(pairsCount);
+	}
+}
+
+// Hashes a file as a Merkle tree of chunks, which are hashed in parallel by the given amount of workers
+// Returns a string of the tree root or a null pointer if the file can't be read
+char* hashFileTree(const char* path, size_t chunkBytes, unsigned int workersCount)
+{
+	if (chunkBytes == 0 || workersCount == 0)
+	{
+		return nullptr;
+	}
+
+	TreeLeaves leaves;
+	if (!openReadableFile(path, leaves.file))
+	{
+		return nullptr;
+	}
+
+	unsigned long long chunksCount = (leaves.file.size + chunkBytes - 1) / chunkBytes;
+	leaves.chunkBytes = chunkBytes;
+	leaves.digests.resize(chunksCount == 0 ? 1 : (size_t)chunksCount);
+	leaves.nextChunk = 0;
+	leaves.hasFailed = false;
+
+	vector<thread> workers;
+	for (unsigned int i = 0; i < workersCount && i < leaves.digests.size(); i++)
+	{
+		workers.emplace_back(hashLeavesWorker, ref(leaves));
+	}
+
+	for (thread& worker : workers)
+	{
+		worker.join();
+	}
+
+	closeReadableFile(leaves.file);
+	if (leaves.hasFailed)
+	{
+		return nullptr;
+	}
+
+	reduceTreeLevels(leaves.digests);
+
+	return getDigestText(leaves.digests[0]);
+}
\ No newline at end of file
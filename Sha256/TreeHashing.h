@@ -0,0 +1,29 @@
+/**
+*
+* Solution to course project # 6
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2022/2023
+*
+* @author Ivan Emanuilov Makaveev
+* @idnumber 2MI0600203
+* @compiler VC
+*
+* This file contains the declaration of the parallel tree hashing of files and of the RFC 6962 leaf and node hashes
+* Its results are Merkle tree roots and differ from the plain SHA256 hash of the same file
+*
+*/
+
+#pragma once
+
+#include <cstddef>
+
+#include "SHA256.h"
+
+const size_t TREE_CHUNK_BYTES = 1 << 20;
+
+void initTreeLeafContext(Sha256Context& context);
+void hashTreeLeaf(const void* data, size_t size, Digest& leaf);
+void hashTreeNode(const Digest& left, const Digest& right, Digest& node);
+
+char* hashFileTree(const char* path, size_t chunkBytes, unsigned int workersCount);
\ No newline at end of file
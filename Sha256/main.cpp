@@ -11,48 +11,29 @@
 *
 * This file is the starting point of the program
 * It allows the user to work with files and apply the hashing algorithm to their contents
+* When started with command line arguments it runs the non-interactive batch mode instead
 *
 */
 
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
-
+#include <thread>
+
+#include "BatchMode.h"
+#include "Benchmark.h"
+#include "Cavp.h"
+#include "Daemon.h"
+#include "DigestCache.h"
+#include "FileHashing.h"
 #include "Helpers.h"
+#include "NonceSearch.h"
 #include "SHA256.h"
+#include "Sha256Constexpr.h"
+#include "SelfTest.h"
 
 using namespace std;
 
-unsigned int getMin(unsigned int first, unsigned int second)
-{
-	return first > second ? second : first;
-}
-
-// Reads a string with a given amount from file
-// If the file doesn't have that many characters, updates the characters to read count
-char* readFromFile(const char* path, size_t charsToRead)
-{
-	ifstream inputFile;
-	inputFile.open(path);
-
-	char* text = nullptr;
-	if (inputFile.is_open())
-	{
-		inputFile.seekg(0, ios::end);
-		size_t fileSize = (size_t)inputFile.tellg();
-		inputFile.seekg(0, ios::beg);
-
-		size_t requiredSize = getMin(fileSize, charsToRead);
-
-		text = new char[requiredSize + 1];
-		inputFile.read(text, requiredSize);
-		text[requiredSize] = '\0';
-	}
-
-	inputFile.close();
-
-	return text;
-}
-
 // Writes a given text result to a file
 bool writeInFile(const char* path, const char* text)
 {
@@ -141,22 +122,43 @@ void inputFileSequence(char* path, size_t size)
 	cin.getline(path, size);
 }
 
+// Returns the digest cache kept in the file named by the SHA256_CACHE environment variable
+// Returns a null pointer if the variable isn't set or the cache can't be opened
+DigestCache* getInteractiveCache()
+{
+	const char* CACHE_VARIABLE = "SHA256_CACHE";
+
+	static DigestCache cache;
+	static const bool IS_OPEN = getenv(CACHE_VARIABLE) != nullptr && openDigestCache(getenv(CACHE_VARIABLE), cache);
+
+	return IS_OPEN ? &cache : nullptr;
+}
+
 // Hashes the text from a given file
-char* hashFromFile(const char* path, size_t symbols)
+// The file is streamed through the hashing algorithm instead of being read into memory first
+// A whole unchanged file is answered from the digest cache if there is one
+bool hashFromFile(const char* path, unsigned long long symbols, Digest& digest)
 {
-	char* fileText = readFromFile(path, symbols);
-	char* result = hashMessage(fileText);
-	delete[] fileText;
+	const unsigned long long WHOLE_FILE = (unsigned long long)-1;
 
-	return result;
+	DigestCache* cache = getInteractiveCache();
+	if (symbols == WHOLE_FILE && cache != nullptr)
+	{
+		return hashFileCached(*cache, path, false, hashFileDigest, digest) != HASH_UNREADABLE;
+	}
+
+	return hashFileDigest(path, symbols, digest);
 }
 
 // Console Hash command sequence of operations
-void hashSequence(const char* hash)
+void hashSequence(const Digest& digest)
 {
 	const char EXIT_KEY = '0';
 	const char* OUTPUT_PATH = "output.txt";
 
+	char hash[DIGEST_TEXT_SIZE];
+	formatDigest(digest, hash);
+
 	cout << "Hash result:" << endl;
 	cout << hash << endl;
 
@@ -183,15 +185,20 @@ void hashSequence(const char* hash)
 }
 
 // Console Compare command sequence of operations
-void compareSequence(const char* hash)
+// The entered hash is decoded once and compared as raw bytes in constant time
+void compareSequence(const Digest& digest)
 {
-	const size_t HASH_SIZE = 64;
-	char hashInput[HASH_SIZE + 1] = "";
+	char hashInput[DIGEST_TEXT_SIZE] = "";
 	cout << "Please, enter a comparison hash" << endl;
-	cin.getline(hashInput, HASH_SIZE + 1);
+	cin.getline(hashInput, DIGEST_TEXT_SIZE);
 
-	bool isMatching = areTextsEqual(hash, hashInput);
-	if (isMatching)
+	Digest inputDigest;
+	bool isValid = parseDigest(hashInput, getLength(hashInput), inputDigest);
+	if (!isValid)
+	{
+		cout << "The entered text isn't a valid hash" << endl;
+	}
+	else if (areDigestsEqual(digest, inputDigest))
 	{
 		cout << "The message matches the given hash" << endl;
 	}
@@ -202,7 +209,7 @@ void compareSequence(const char* hash)
 }
 
 // Initial sequence for any operation
-void initiateSequence(void (*sequence)(const char* hash))
+void initiateSequence(void (*sequence)(const Digest& digest))
 {
 	const size_t PATH_MAX_SIZE = 256;
 
@@ -211,17 +218,20 @@ void initiateSequence(void (*sequence)(const char* hash))
 
 	if (validateTextPath(path))
 	{
-		size_t symbolsToRead = 0;
+		unsigned long long symbolsToRead = 0;
 		cout << "Please enter how many symbols would you like to read from this file:" << endl;
 		cout << "(Enter -1 if you want to read the whole file)" << endl;
 		cin >> symbolsToRead;
 		cin.ignore();
 
-		char* result = hashFromFile(path, symbolsToRead);
-
-		sequence(result);
+		Digest digest;
+		if (!hashFromFile(path, symbolsToRead, digest))
+		{
+			cout << "The file couldn't be read!" << endl;
+			return;
+		}
 
-		delete[] result;
+		sequence(digest);
 	}
 	else
 	{
@@ -230,8 +240,120 @@ void initiateSequence(void (*sequence)(const char* hash))
 	}
 }
 
-int main()
+// Runs the built-in benchmark, optionally up to a given message size
+int benchmarkSequence(int argc, char** argv)
+{
+	const unsigned long long DEFAULT_MAX_MESSAGE_BYTES = 64ULL << 20;
+
+	unsigned long long maxMessageBytes = DEFAULT_MAX_MESSAGE_BYTES;
+	if (argc > 2)
+	{
+		maxMessageBytes = strtoull(argv[2], nullptr, 10);
+	}
+
+	return runBenchmark(maxMessageBytes);
+}
+
+// Searches for a nonce of a block header given in hexadecimal and prints it with the hash rate
+// Takes the header, the target in digest byte order and optionally the amount of nonces and workers
+int nonceSearchSequence(int argc, char** argv)
+{
+	const unsigned long long DEFAULT_NONCES_COUNT = 1ULL << 32;
+
+	unsigned char header[BLOCK_HEADER_BYTES];
+	Digest target;
+	if (argc < 4 ||
+		!(getLength(argv[2]) == 2 * BLOCK_HEADER_BYTES && parseHex(argv[2], 2 * BLOCK_HEADER_BYTES, header)) ||
+		!parseDigest(argv[3], getLength(argv[3]), target))
+	{
+		cerr << "Usage: Sha256 --search-nonce <header - 160 hex digits> <target - 64 hex digits> [nonces] [workers]" << endl;
+		return EXIT_FAILURE;
+	}
+
+	unsigned long long noncesCount = argc > 4 ? strtoull(argv[4], nullptr, 10) : DEFAULT_NONCES_COUNT;
+	unsigned int workersCount = argc > 5 ? (unsigned int)strtoul(argv[5], nullptr, 10) : thread::hardware_concurrency();
+	if (workersCount == 0)
+	{
+		workersCount = 1;
+	}
+
+	NonceSearchResult result;
+	searchNonce(header, target, noncesCount, workersCount, result);
+
+	if (result.isFound)
+	{
+		char hash[DIGEST_TEXT_SIZE];
+		formatDigest(result.digest, hash);
+		cout << "Nonce: " << result.nonce << endl;
+		cout << "Hash: " << hash << endl;
+	}
+	else
+	{
+		cout << "No nonce within the target was found" << endl;
+	}
+
+	double hashesPerSecond = result.seconds > 0 ? result.hashesCount / result.seconds : 0;
+	cout << "Hashes: " << result.hashesCount << " in " << result.seconds << " s (" << hashesPerSecond / 1e6 << " MH/s)" << endl;
+
+	return result.isFound ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Runs the hashing daemon on a socket path until it is stopped, optionally with a given amount of workers
+int daemonSequence(int argc, char** argv)
 {
+	if (argc < 3)
+	{
+		cerr << "Usage: Sha256 --daemon <socket path> [workers]" << endl;
+		return EXIT_FAILURE;
+	}
+
+	unsigned int workersCount = argc > 3 ? (unsigned int)strtoul(argv[3], nullptr, 10) : thread::hardware_concurrency();
+	if (workersCount == 0)
+	{
+		workersCount = 1;
+	}
+
+	return runHashDaemon(argv[2], workersCount) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char** argv)
+{
+	const char* BENCHMARK_OPTION = "--benchmark";
+	const char* NONCE_SEARCH_OPTION = "--search-nonce";
+	const char* DAEMON_OPTION = "--daemon";
+	const char* CAVP_OPTION = "--cavp";
+	const char* SELF_TEST_OPTION = "--self-test";
+
+	if (argc > 1 && areTextsEqual(argv[1], BENCHMARK_OPTION))
+	{
+		return benchmarkSequence(argc, argv);
+	}
+
+	if (argc > 1 && areTextsEqual(argv[1], SELF_TEST_OPTION))
+	{
+		return runSelfTest();
+	}
+
+	if (argc > 1 && areTextsEqual(argv[1], NONCE_SEARCH_OPTION))
+	{
+		return nonceSearchSequence(argc, argv);
+	}
+
+	if (argc > 1 && areTextsEqual(argv[1], CAVP_OPTION))
+	{
+		return runCavp(argv + 2, argc - 2);
+	}
+
+	if (argc > 1 && areTextsEqual(argv[1], DAEMON_OPTION))
+	{
+		return daemonSequence(argc, argv);
+	}
+
+	if (argc > 1)
+	{
+		return runBatchMode(argc, argv);
+	}
+
 	const char EXIT_COMMAND = 'E';
 	const char HASH_COMMAND = 'H';
 	const char COMPARE_COMMAND = 'C';